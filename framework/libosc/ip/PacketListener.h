@@ -45,6 +45,14 @@ public:
     virtual ~PacketListener() {}
     virtual void ProcessPacket( const char *data, int size, 
 			const IpEndpointName& remoteEndpoint ) = 0;
+
+    // called instead of ProcessPacket when the socket has kernel receive
+    // timestamps enabled (see UdpSocket::SetEnableTimestamps). timestampNs
+    // is the wall clock receive time in nanoseconds, or 0 when the kernel
+    // didn't provide a timestamp for the packet
+    virtual void ProcessTimestampedPacket( const char *data, int size, 
+			const IpEndpointName& remoteEndpoint, long long /*timestampNs*/ )
+        { ProcessPacket( data, size, remoteEndpoint ); }
 };
 
 #endif /* INCLUDED_OSCPACK_PACKETLISTENER_H */
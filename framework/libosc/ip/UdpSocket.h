@@ -102,6 +102,17 @@ public:
 	// operating systems.
 	void SetAllowReuse( bool allowReuse );
 
+	// Set the size of the kernel receive buffer in bytes. A larger
+	// buffer reduces packet loss when many senders flood the socket.
+	// Sets SO_RCVBUF. The kernel may clamp or round the size.
+	void SetReceiveBufferSize( int size );
+
+	// Enable per-packet kernel receive timestamps, which are passed to
+	// PacketListener::ProcessTimestampedPacket.
+	// Sets SO_TIMESTAMPNS on Linux. Not supported on other platforms.
+	void SetEnableTimestamps( bool enableTimestamps );
+	bool TimestampsEnabled() const;
+
 
 	// The socket is created in an unbound, unconnected state
 	// such a socket can only be used to send to an arbitrary
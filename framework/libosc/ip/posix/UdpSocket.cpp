@@ -66,6 +66,40 @@
 typedef ssize_t socklen_t;
 #endif
 
+#if defined(__linux__)
+// receive datagrams in batches using recvmmsg, instead of one recvfrom per datagram
+#define OSCPACK_USE_RECVMMSG 1
+#endif
+
+#if OSCPACK_USE_RECVMMSG
+#include <sys/uio.h>
+#include <time.h>
+
+// preallocated buffers for receiving a batch of datagrams with a single recvmmsg call
+struct ReceiveBatch{
+    enum { MAX_PACKETS = 32, MAX_BUFFER_SIZE = 4098, MAX_CONTROL_SIZE = 64 };
+
+    char data[ MAX_PACKETS ][ MAX_BUFFER_SIZE ];
+    char control[ MAX_PACKETS ][ MAX_CONTROL_SIZE ];
+    struct sockaddr_in fromAddr[ MAX_PACKETS ];
+    struct iovec iov[ MAX_PACKETS ];
+    struct mmsghdr messages[ MAX_PACKETS ];
+};
+
+static long long TimestampNsFromMsghdr( struct msghdr& message )
+{
+    for( struct cmsghdr *cmsg = CMSG_FIRSTHDR( &message ); cmsg != 0; cmsg = CMSG_NXTHDR( &message, cmsg ) ){
+        if( cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS ){
+            struct timespec ts;
+            std::memcpy( &ts, CMSG_DATA( cmsg ), sizeof(ts) );
+            return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+        }
+    }
+
+    return 0;
+}
+#endif
+
 
 static void SockaddrFromIpEndpointName( struct sockaddr_in& sockAddr, const IpEndpointName& endpoint )
 {
@@ -100,6 +134,7 @@ static IpEndpointName IpEndpointNameFromSockaddr( const struct sockaddr_in& sock
 class UdpSocket::Implementation{
 	bool isBound_;
 	bool isConnected_;
+	bool timestampsEnabled_;
 
 	int socket_;
 	struct sockaddr_in connectedAddr_;
@@ -110,6 +145,7 @@ public:
 	Implementation()
 		: isBound_( false )
 		, isConnected_( false )
+		, timestampsEnabled_( false )
 		, socket_( -1 )
 	{
 		if( (socket_ = socket( AF_INET, SOCK_DGRAM, 0 )) == -1 ){
@@ -143,6 +179,24 @@ public:
 #endif
 	}
 
+	void SetReceiveBufferSize( int size )
+	{
+		setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	}
+
+	void SetEnableTimestamps( bool enableTimestamps )
+	{
+#if OSCPACK_USE_RECVMMSG && defined(SO_TIMESTAMPNS)
+		int timestamps = (enableTimestamps) ? 1 : 0; // int on posix
+		if( setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPNS, &timestamps, sizeof(timestamps)) == 0 )
+			timestampsEnabled_ = enableTimestamps;
+#else
+		(void)enableTimestamps; // kernel receive timestamps are only supported with the recvmmsg receive path
+#endif
+	}
+
+	bool TimestampsEnabled() const { return timestampsEnabled_; }
+
 	IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
 	{
 		assert( isBound_ );
@@ -246,6 +300,37 @@ public:
 		return (std::size_t)result;
 	}
 
+#if OSCPACK_USE_RECVMMSG
+	// receive as many datagrams as are available, up to the size of the batch,
+	// without blocking. returns the number of datagrams received
+	int ReceiveBatch( ReceiveBatch& batch )
+	{
+		assert( isBound_ );
+
+		for( int i = 0; i < ReceiveBatch::MAX_PACKETS; ++i ){
+			batch.iov[i].iov_base = batch.data[i];
+			batch.iov[i].iov_len = ReceiveBatch::MAX_BUFFER_SIZE;
+
+			struct msghdr& message = batch.messages[i].msg_hdr;
+			std::memset( &message, 0, sizeof(message) );
+			message.msg_name = &batch.fromAddr[i];
+			message.msg_namelen = sizeof(batch.fromAddr[i]);
+			message.msg_iov = &batch.iov[i];
+			message.msg_iovlen = 1;
+			if( timestampsEnabled_ ){
+				message.msg_control = batch.control[i];
+				message.msg_controllen = ReceiveBatch::MAX_CONTROL_SIZE;
+			}
+		}
+
+		int result = recvmmsg(socket_, batch.messages, ReceiveBatch::MAX_PACKETS, MSG_DONTWAIT, 0);
+		if( result < 0 )
+			return 0;
+
+		return result;
+	}
+#endif
+
 	int Socket() { return socket_; }
 };
 
@@ -269,6 +354,21 @@ void UdpSocket::SetAllowReuse( bool allowReuse )
     impl_->SetAllowReuse( allowReuse );
 }
 
+void UdpSocket::SetReceiveBufferSize( int size )
+{
+    impl_->SetReceiveBufferSize( size );
+}
+
+void UdpSocket::SetEnableTimestamps( bool enableTimestamps )
+{
+    impl_->SetEnableTimestamps( enableTimestamps );
+}
+
+bool UdpSocket::TimestampsEnabled() const
+{
+    return impl_->TimestampsEnabled();
+}
+
 IpEndpointName UdpSocket::LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
 {
 	return impl_->LocalEndpointFor( remoteEndpoint );
@@ -406,6 +506,9 @@ public:
 	{
 		break_ = false;
         char *data = 0;
+#if OSCPACK_USE_RECVMMSG
+        ReceiveBatch *batch = 0;
+#endif
         
         try{
             
@@ -443,6 +546,13 @@ public:
             const int MAX_BUFFER_SIZE = 4098;
             data = new char[ MAX_BUFFER_SIZE ];
             IpEndpointName remoteEndpoint;
+#if OSCPACK_USE_RECVMMSG
+            batch = new ReceiveBatch;
+
+            // limit the number of batches read from a single socket before moving on,
+            // so a flooded socket doesn't starve the other sockets and the timers
+            const int MAX_BATCHES_PER_SOCKET = 8;
+#endif
 
             struct timeval timeout;
 
@@ -490,12 +600,42 @@ public:
 
                     if( FD_ISSET( i->second->impl_->Socket(), &tempfds ) ){
 
+#if OSCPACK_USE_RECVMMSG
+                        const bool timestampsEnabled = i->second->impl_->TimestampsEnabled();
+
+                        for( int b = 0; b < MAX_BATCHES_PER_SOCKET && !break_; ++b ){
+                            int count = i->second->impl_->ReceiveBatch( *batch );
+
+                            for( int j = 0; j < count && !break_; ++j ){
+                                struct mmsghdr& message = batch->messages[j];
+                                if( message.msg_len == 0 )
+                                    continue;
+
+                                remoteEndpoint.address = ntohl(batch->fromAddr[j].sin_addr.s_addr);
+                                remoteEndpoint.port = ntohs(batch->fromAddr[j].sin_port);
+
+                                if( timestampsEnabled ){
+                                    long long timestampNs = TimestampNsFromMsghdr( message.msg_hdr );
+                                    i->first->ProcessTimestampedPacket( batch->data[j], (int)message.msg_len, remoteEndpoint, timestampNs );
+                                }else{
+                                    i->first->ProcessPacket( batch->data[j], (int)message.msg_len, remoteEndpoint );
+                                }
+                            }
+
+                            // a partial batch means the socket has been drained
+                            if( count < ReceiveBatch::MAX_PACKETS )
+                                break;
+                        }
+                        if( break_ )
+                            break;
+#else
                         std::size_t size = i->second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
                         if( size > 0 ){
                             i->first->ProcessPacket( data, (int)size, remoteEndpoint );
                             if( break_ )
                                 break;
                         }
+#endif
                     }
                 }
 
@@ -517,9 +657,16 @@ public:
             }
 
             delete [] data;
+#if OSCPACK_USE_RECVMMSG
+            delete batch;
+#endif
         }catch(...){
             if( data )
                 delete [] data;
+#if OSCPACK_USE_RECVMMSG
+            if( batch )
+                delete batch;
+#endif
             throw;
         }
 	}
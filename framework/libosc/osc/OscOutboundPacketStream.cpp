@@ -678,6 +678,43 @@ OutboundPacketStream& OutboundPacketStream::operator<<( const ArrayTerminator& r
     return *this;
 }
 
+
+OutboundPacketPool::OutboundPacketPool( std::size_t packetCapacity )
+    : packetCapacity_( packetCapacity )
+    , count_( 0 )
+{
+}
+
+
+OutboundPacketPool::~OutboundPacketPool()
+{
+    for( std::size_t i=0; i < streams_.size(); ++i ){
+        delete streams_[i];
+        delete [] buffers_[i];
+    }
+}
+
+
+OutboundPacketStream& OutboundPacketPool::Acquire()
+{
+    if( count_ == streams_.size() ){
+        char *buffer = new char[ packetCapacity_ ];
+        buffers_.push_back( buffer );
+        streams_.push_back( new OutboundPacketStream( buffer, packetCapacity_ ) );
+    }
+
+    OutboundPacketStream& result = *streams_[count_++];
+    result.Clear();
+
+    return result;
+}
+
+
+void OutboundPacketPool::ReleaseAll()
+{
+    count_ = 0;
+}
+
 } // namespace osc
 
 
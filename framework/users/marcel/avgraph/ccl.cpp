@@ -1,6 +1,8 @@
 #include "ccl.h"
 #include "framework.h"
 #include "json.hpp"
+#include <fstream>
+#include <stdexcept>
 
 #include "FileStream.h"
 #include "StreamReader.h"
@@ -13,12 +15,20 @@
 #include "../libparticle/ui.h"
 
 #include "cclKinect.h"
+#include "vfxScheduler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CCL_USE_SSE 1
+	#include <emmintrin.h>
+#else
+	#define CCL_USE_SSE 0
+#endif
+
+#include <float.h>
 
 extern const int GFX_SX;
 extern const int GFX_SY;
 
-extern void splitString(const std::string & str, std::vector<std::string> & result, char c);
-
 //
 
 using json = nlohmann::json;
@@ -43,23 +53,38 @@ static double Mix(const double a, const double b, const double t)
 //
 
 MotionBankChannel::MotionBankChannel()
-	: keys()
+	: keys(nullptr)
+	, numKeys(0)
+	, ownedKeys()
+	, sampleRate(0.f)
 	, nextReadIndex()
 {
 }
 
+void MotionBankChannel::useOwnedKeys()
+{
+	keys = ownedKeys.empty() ? nullptr : &ownedKeys[0];
+	numKeys = ownedKeys.size();
+	
+	nextReadIndex = 0;
+}
+
 void MotionBankChannel::seek(const float time)
 {
 	while (nextReadIndex - 1 > 0 && time < keys[nextReadIndex].time)
 		nextReadIndex--;
 	
-	while (nextReadIndex + 1 < keys.size() && time >= keys[nextReadIndex + 1].time)
+	while (nextReadIndex + 1 < numKeys && time >= keys[nextReadIndex + 1].time)
 		nextReadIndex++;
 }
 
 float MotionBankChannel::interp(const float time)
 {
-	if (nextReadIndex + 1 == keys.size())
+	if (numKeys == 0)
+	{
+		return 0.f;
+	}
+	else if (nextReadIndex + 1 == numKeys)
 	{
 		return keys[nextReadIndex].value;
 	}
@@ -77,6 +102,87 @@ float MotionBankChannel::interp(const float time)
 	}
 }
 
+void MotionBankJoint::finalizeImport()
+{
+	const bool isUniform =
+		px.sampleRate > 0.f &&
+		px.sampleRate == py.sampleRate &&
+		px.sampleRate == pz.sampleRate &&
+		!px.ownedKeys.empty() &&
+		px.ownedKeys.size() == py.ownedKeys.size() &&
+		px.ownedKeys.size() == pz.ownedKeys.size();
+	
+	if (isUniform)
+	{
+		// interleave the channels. they aren't needed anymore afterwards
+		
+		ownedSamples.resize(px.ownedKeys.size());
+		
+		for (size_t i = 0; i < ownedSamples.size(); ++i)
+		{
+			ownedSamples[i].p[0] = px.ownedKeys[i].value;
+			ownedSamples[i].p[1] = py.ownedKeys[i].value;
+			ownedSamples[i].p[2] = pz.ownedKeys[i].value;
+		}
+		
+		samples = &ownedSamples[0];
+		numSamples = ownedSamples.size();
+		sampleRate = px.sampleRate;
+		
+		px.ownedKeys = std::vector<MotionBankKey>();
+		py.ownedKeys = std::vector<MotionBankKey>();
+		pz.ownedKeys = std::vector<MotionBankKey>();
+	}
+	
+	px.useOwnedKeys();
+	py.useOwnedKeys();
+	pz.useOwnedKeys();
+}
+
+void MotionBankJoint::sampleUniform(const float time, float * p, float * v) const
+{
+	const float position = time * sampleRate;
+	
+	if (position >= numSamples - 1)
+	{
+		const MotionBankSample & s = samples[numSamples - 1];
+		
+		for (int i = 0; i < 3; ++i)
+		{
+			p[i] = s.p[i];
+			v[i] = 0.f;
+		}
+	}
+	else if (!(position > 0.f))
+	{
+		const MotionBankSample & s = samples[0];
+		
+		for (int i = 0; i < 3; ++i)
+		{
+			p[i] = s.p[i];
+			v[i] = 0.f;
+		}
+	}
+	else
+	{
+		const int index = int(position);
+		const float t = position - index;
+		
+		const MotionBankSample & s1 = samples[index + 0];
+		const MotionBankSample & s2 = samples[index + 1];
+		
+		// note : the velocity is the slope between the two samples, which is what differentiating the linear interpolation gives
+		
+		for (int i = 0; i < 3; ++i)
+		{
+			const float d = s2.p[i] - s1.p[i];
+			
+			p[i] = s1.p[i] + d * t;
+			v[i] = d * sampleRate;
+		}
+	}
+}
+
 //
 
 static int intValue(json::reference j, const char * name, int defaultValue)
@@ -97,84 +203,287 @@ static std::string stringValue(json::reference j, const char * name, const char
 		return v.get<std::string>();
 }
 
-static void readChannel(MotionBankChannel & channel, StreamReader & reader)
+// motion bank cache files are memory mapped and used in place. a cache file consists of a header, a table
+// of joints, the joint names and the keys of each channel. keys are aligned to 16 bytes. the cache stores
+// the modification time and size of the file it was imported from, so it can be rebuilt when the source
+// changes, and a checksum of everything following the header to detect truncated or damaged files
+
+static const uint32_t kMotionBankCacheMagic = 'M' | ('B' << 8) | ('N' << 16) | ('K' << 24);
+static const uint32_t kMotionBankCacheVersion = 2;
+
+static const size_t kMotionBankCacheKeyAlignment = 16;
+
+struct MotionBankCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t fileSize;
+	uint64_t sourceModificationTime;
+	uint64_t sourceFileSize;
+	uint64_t checksum;
+	uint32_t numJoints;
+	uint32_t padding;
+};
+
+struct MotionBankCacheChannel
+{
+	uint64_t keysOffset;
+	uint32_t numKeys;
+	float sampleRate;
+};
+
+struct MotionBankCacheJoint
 {
-	const int numKeys = reader.ReadInt32();
+	uint32_t nameOffset;
+	uint32_t nameLength;
 	
-	channel.keys.resize(numKeys);
+	uint64_t samplesOffset;
+	uint32_t numSamples;
+	float sampleRate;
 	
-	reader.ReadBytes(&channel.keys[0], sizeof(MotionBankKey) * channel.keys.size());
-}
+	MotionBankCacheChannel channels[3];
+};
 
-static void writeChannel(const MotionBankChannel & channel, StreamWriter & writer)
+static uint64_t calculateCacheChecksum(const uint8_t * bytes, const size_t numBytes)
 {
-	writer.WriteInt32(channel.keys.size());
+	// FNV-1a over 64 bit words, which is fast enough to verify large caches on load
+	
+	const uint64_t prime = 0x100000001b3ull;
+	
+	uint64_t hash = 0xcbf29ce484222325ull;
+	
+	size_t i = 0;
+	
+	for (; i + 8 <= numBytes; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		
+		hash = (hash ^ word) * prime;
+	}
+	
+	for (; i < numBytes; ++i)
+	{
+		hash = (hash ^ bytes[i]) * prime;
+	}
 	
-	writer.WriteBytes(&channel.keys[0], sizeof(MotionBankKey) * channel.keys.size());
+	return hash;
+}
+
+static size_t alignCacheOffset(const size_t offset)
+{
+	return (offset + kMotionBankCacheKeyAlignment - 1) & ~(kMotionBankCacheKeyAlignment - 1);
 }
 
-bool MotionBankProvider::load(const char * filename)
+bool MotionBankProvider::load(const char * filename, const char * sourceFilename)
 {
-	//return false;
+	joints.clear();
 	
-	try
+	cacheFile.close();
+	
+	if (!cacheFile.open(filename))
+		return false;
+	
+	const uint8_t * bytes = (const uint8_t*)cacheFile.data;
+	const size_t numBytes = cacheFile.size;
+	
+	const MotionBankCacheHeader * header = (const MotionBankCacheHeader*)bytes;
+	
+	const char * error = nullptr;
+	
+	if (numBytes < sizeof(MotionBankCacheHeader) || header->magic != kMotionBankCacheMagic || header->version != kMotionBankCacheVersion)
+		error = "cache file was written by a different version";
+	else if (header->fileSize != numBytes)
+		error = "cache file is truncated";
+	else if (numBytes < sizeof(MotionBankCacheHeader) + uint64_t(header->numJoints) * sizeof(MotionBankCacheJoint))
+		error = "joint table exceeds the size of the cache file";
+	else if (calculateCacheChecksum(bytes + sizeof(MotionBankCacheHeader), numBytes - sizeof(MotionBankCacheHeader)) != header->checksum)
+		error = "checksum mismatch";
+	
+	if (error == nullptr && sourceFilename != nullptr)
 	{
-		joints.clear();
-		
-		//
+		uint64_t sourceModificationTime;
+		uint64_t sourceFileSize;
 		
-		FileStream stream;
-		stream.Open(filename, OpenMode_Read);
-		StreamReader reader(&stream, false);
-		
-		const int numJoints = reader.ReadInt32();
+		// note : when the source file doesn't exist, the cache is all we have, so it's used as-is
 		
-		if (numJoints <= 0)
-			return false;
+		if (MappedFile::getFileInfo(sourceFilename, sourceModificationTime, sourceFileSize) &&
+			(sourceModificationTime != header->sourceModificationTime || sourceFileSize != header->sourceFileSize))
+		{
+			error = "source file has changed";
+		}
+	}
+	
+	if (error == nullptr)
+	{
+		const MotionBankCacheJoint * cacheJoints = (const MotionBankCacheJoint*)(bytes + sizeof(MotionBankCacheHeader));
 		
-		for (int i = 0; i < numJoints; ++i)
+		for (uint32_t i = 0; i < header->numJoints && error == nullptr; ++i)
 		{
-			char name[256];
-			reader.ReadText_Binary(name, sizeof(name));
+			const MotionBankCacheJoint & cacheJoint = cacheJoints[i];
+			
+			if (uint64_t(cacheJoint.nameOffset) + cacheJoint.nameLength > numBytes)
+			{
+				error = "joint name exceeds the size of the cache file";
+				break;
+			}
+			
+			MotionBankJoint & joint = joints[std::string((const char*)bytes + cacheJoint.nameOffset, cacheJoint.nameLength)];
+			
+			if (cacheJoint.numSamples > 0)
+			{
+				if (cacheJoint.samplesOffset % kMotionBankCacheKeyAlignment != 0 ||
+					cacheJoint.samplesOffset + uint64_t(cacheJoint.numSamples) * sizeof(MotionBankSample) > numBytes ||
+					!(cacheJoint.sampleRate > 0.f))
+				{
+					error = "joint samples exceed the size of the cache file";
+					break;
+				}
+				
+				joint.samples = (const MotionBankSample*)(bytes + cacheJoint.samplesOffset);
+				joint.numSamples = cacheJoint.numSamples;
+				joint.sampleRate = cacheJoint.sampleRate;
+			}
 			
-			MotionBankJoint & joint = joints[name];
+			MotionBankChannel * channels[3] = { &joint.px, &joint.py, &joint.pz };
 			
-			readChannel(joint.px, reader);
-			readChannel(joint.py, reader);
-			readChannel(joint.pz, reader);
+			for (int c = 0; c < 3; ++c)
+			{
+				const MotionBankCacheChannel & cacheChannel = cacheJoint.channels[c];
+				
+				if (cacheChannel.keysOffset % kMotionBankCacheKeyAlignment != 0 ||
+					cacheChannel.keysOffset + uint64_t(cacheChannel.numKeys) * sizeof(MotionBankKey) > numBytes)
+				{
+					error = "channel keys exceed the size of the cache file";
+					break;
+				}
+				
+				channels[c]->keys = (const MotionBankKey*)(bytes + cacheChannel.keysOffset);
+				channels[c]->numKeys = cacheChannel.numKeys;
+				channels[c]->sampleRate = cacheChannel.sampleRate;
+			}
 		}
-		
-		return true;
 	}
-	catch (std::exception & e)
+	
+	if (error != nullptr)
 	{
-		logError(e.what());
+		logDebug("%s: %s. ignoring cache", filename, error);
+		
+		joints.clear();
+		
+		cacheFile.close();
 		
 		return false;
 	}
+	
+	return true;
 }
 
-bool MotionBankProvider::save(const char * filename) const
+bool MotionBankProvider::save(const char * filename, const char * sourceFilename) const
 {
-	try
+	// lay out the file
+	
+	size_t numBytes = sizeof(MotionBankCacheHeader) + joints.size() * sizeof(MotionBankCacheJoint);
+	
+	for (auto & nameAndJoint : joints)
+		numBytes += nameAndJoint.first.size();
+	
+	for (auto & nameAndJoint : joints)
 	{
-		FileStream stream;
-		stream.Open(filename, OpenMode_Write);
-		StreamWriter writer(&stream, false);
+		const MotionBankJoint & joint = nameAndJoint.second;
+		
+		numBytes = alignCacheOffset(numBytes) + joint.numSamples * sizeof(MotionBankSample);
+		numBytes = alignCacheOffset(numBytes) + joint.px.numKeys * sizeof(MotionBankKey);
+		numBytes = alignCacheOffset(numBytes) + joint.py.numKeys * sizeof(MotionBankKey);
+		numBytes = alignCacheOffset(numBytes) + joint.pz.numKeys * sizeof(MotionBankKey);
+	}
+	
+	std::vector<uint8_t> bytes;
+	bytes.resize(numBytes, 0);
+	
+	// fill in the joint table, names and keys
+	
+	MotionBankCacheJoint * cacheJoints = (MotionBankCacheJoint*)&bytes[sizeof(MotionBankCacheHeader)];
+	
+	size_t offset = sizeof(MotionBankCacheHeader) + joints.size() * sizeof(MotionBankCacheJoint);
+	
+	int jointIndex = 0;
+	
+	for (auto & nameAndJoint : joints)
+	{
+		const std::string & name = nameAndJoint.first;
+		
+		MotionBankCacheJoint & cacheJoint = cacheJoints[jointIndex++];
+		
+		cacheJoint.nameOffset = offset;
+		cacheJoint.nameLength = name.size();
+		
+		memcpy(&bytes[offset], name.c_str(), name.size());
+		
+		offset += name.size();
+	}
+	
+	jointIndex = 0;
+	
+	for (auto & nameAndJoint : joints)
+	{
+		const MotionBankJoint & joint = nameAndJoint.second;
+		
+		const MotionBankChannel * channels[3] = { &joint.px, &joint.py, &joint.pz };
+		
+		MotionBankCacheJoint & cacheJoint = cacheJoints[jointIndex++];
+		
+		offset = alignCacheOffset(offset);
 		
-		writer.WriteInt32(joints.size());
+		cacheJoint.samplesOffset = offset;
+		cacheJoint.numSamples = joint.numSamples;
+		cacheJoint.sampleRate = joint.sampleRate;
 		
-		for (auto & nameAndJoint : joints)
+		if (joint.numSamples > 0)
+			memcpy(&bytes[offset], joint.samples, joint.numSamples * sizeof(MotionBankSample));
+		
+		offset += joint.numSamples * sizeof(MotionBankSample);
+		
+		for (int c = 0; c < 3; ++c)
 		{
-			const std::string & name = nameAndJoint.first;
-			const MotionBankJoint & joint = nameAndJoint.second;
+			offset = alignCacheOffset(offset);
 			
-			writer.WriteText_Binary(name);
+			cacheJoint.channels[c].keysOffset = offset;
+			cacheJoint.channels[c].numKeys = channels[c]->numKeys;
+			cacheJoint.channels[c].sampleRate = channels[c]->sampleRate;
 			
-			writeChannel(joint.px, writer);
-			writeChannel(joint.py, writer);
-			writeChannel(joint.pz, writer);
+			if (channels[c]->numKeys > 0)
+				memcpy(&bytes[offset], channels[c]->keys, channels[c]->numKeys * sizeof(MotionBankKey));
+			
+			offset += channels[c]->numKeys * sizeof(MotionBankKey);
 		}
+	}
+	
+	Assert(offset == numBytes);
+	
+	// fill in the header
+	
+	MotionBankCacheHeader * header = (MotionBankCacheHeader*)&bytes[0];
+	
+	header->magic = kMotionBankCacheMagic;
+	header->version = kMotionBankCacheVersion;
+	header->fileSize = numBytes;
+	header->sourceModificationTime = 0;
+	header->sourceFileSize = 0;
+	header->numJoints = joints.size();
+	
+	if (sourceFilename != nullptr)
+		MappedFile::getFileInfo(sourceFilename, header->sourceModificationTime, header->sourceFileSize);
+	
+	header->checksum = calculateCacheChecksum(&bytes[sizeof(MotionBankCacheHeader)], numBytes - sizeof(MotionBankCacheHeader));
+	
+	try
+	{
+		FileStream stream;
+		stream.Open(filename, OpenMode_Write);
+		StreamWriter writer(&stream, false);
+		
+		writer.WriteBytes(&bytes[0], bytes.size());
 		
 		return true;
 	}
@@ -186,162 +495,245 @@ bool MotionBankProvider::save(const char * filename) const
 	}
 }
 
-bool MotionBankProvider::import(const char * filename)
+// the importer walks channels -> streams -> frames using the parser callback, so the frames never end up in
+// a json document. frame values are written into the stream's keys as they are parsed, and each stream is
+// removed from the document once it has been handled. only the first channel is imported
+
+struct MotionBankImportState
 {
-	try
+	static const int kMaxDepth = 8;
+	
+	MotionBankProvider & provider;
+	
+	std::ifstream & file;
+	int64_t fileSize;
+	SDL_atomic_t * progress;
+	SDL_atomic_t * cancel;
+	
+	std::string keys[kMaxDepth];
+	int channelIndex;
+	
+	std::vector<MotionBankKey> streamKeys;
+	float lastValue;
+	
+	MotionBankImportState(MotionBankProvider & _provider, std::ifstream & _file, const int64_t _fileSize, SDL_atomic_t * _progress, SDL_atomic_t * _cancel)
+		: provider(_provider)
+		, file(_file)
+		, fileSize(_fileSize)
+		, progress(_progress)
+		, cancel(_cancel)
+		, keys()
+		, channelIndex(-1)
+		, streamKeys()
+		, lastValue(0.f)
+	{
+	}
+	
+	bool isInFirstChannel() const
+	{
+		return keys[1] == "channels" && keys[3] == "streams" && channelIndex == 0;
+	}
+	
+	void updateProgress()
+	{
+		if (cancel != nullptr && SDL_AtomicGet(cancel) != 0)
+			throw std::runtime_error("motion bank import was cancelled");
+		
+		if (progress != nullptr && fileSize > 0)
+		{
+			const int64_t position = file.tellg();
+			
+			if (position >= 0)
+				SDL_AtomicSet(progress, int(position * 1000 / fileSize));
+		}
+	}
+	
+	void handleStream(json & stream)
 	{
-		FileStream file;
-		file.Open(filename, (OpenMode)(OpenMode_Read | OpenMode_Text));
+		auto title = stringValue(stream, "title", "");
+		auto group = stringValue(stream, "group", "");
+		auto frameCount = intValue(stream, "frameCount", 0);
+		auto fps = intValue(stream, "fps", 0);
+		
+		logDebug("stream: %s, group: %s, frameCount: %d, fps: %d", title.c_str(), group.c_str(), frameCount, fps);
+		
+		if (title.empty())
+		{
+			logWarning("title not set. skipping!");
+			return;
+		}
+		
+		if (group.empty())
+		{
+			logWarning("group not set. skipping!");
+			return;
+		}
+		
+		if (frameCount <= 0)
+		{
+			logWarning("frameCount is zero. skipping!");
+			return;
+		}
+		
+		if (fps <= 0)
+		{
+			logWarning("fps is zero. skipping!");
+			return;
+		}
+		
+		if (title != "X" && title != "Y" && title != "Z")
+		{
+			logWarning("joint channel unknown. skipping!");
+			return;
+		}
+		
+		//
+		
+		if (String::StartsWith(group, "V_"))
+		{
+			logDebug("skipping empty joint. it only contains zeroes! joint: %s", group.c_str());
+			return;
+		}
+		
+		//
+		
+		MotionBankJoint & joint = provider.joints[group];
 		
-		StreamReader reader(&file, false);
-		uint8_t * bytes = reader.ReadAllBytes();
-		char * text = (char*)bytes;
-		char * BLHip = strstr(text, "BLHip");
-		BLHip -= 16;
-		json j = json::parse(text);
-		delete[] bytes;
+		MotionBankChannel * jointChannel = nullptr;
 		
-		auto channelsItr = j.find("channels");
+		if (title == "X")
+			jointChannel = &joint.px;
+		if (title == "Y")
+			jointChannel = &joint.py;
+		if (title == "Z")
+			jointChannel = &joint.pz;
 		
-		if (channelsItr != j.end())
+		// note : frames beyond the frame count are dropped, and missing frames are zero
+		
+		streamKeys.resize(frameCount);
+		
+		for (int i = 0; i < frameCount; ++i)
+			streamKeys[i].time = i / float(fps);
+		
+		jointChannel->ownedKeys.swap(streamKeys);
+		jointChannel->sampleRate = fps;
+	}
+	
+	bool handleEvent(const int depth, const json::parse_event_t event, json & parsed)
+	{
+		switch (event)
 		{
-			std::cout << "found channels!" << std::endl;
+		case json::parse_event_t::key:
+			if (depth < kMaxDepth)
+				keys[depth] = parsed.get<std::string>();
+			return true;
 			
-			auto & channels = channelsItr.value();
+		case json::parse_event_t::object_start:
+			if (depth == 2 && keys[1] == "channels")
+			{
+				keys[3].clear();
+				channelIndex++;
+			}
+			else if (depth == 4 && isInFirstChannel())
+			{
+				keys[5].clear();
+				streamKeys.clear();
+				lastValue = 0.f;
+			}
+			return true;
 			
-			for (auto channel : channels)
+		case json::parse_event_t::object_end:
+			if (depth == 4 && keys[1] == "channels" && keys[3] == "streams")
 			{
-				auto title = channel["title"].get<std::string>();
-				
-				std::cout << "channel: " << title << std::endl;
-				
-				std::cout << channel.type_name() << std::endl;
+				if (channelIndex == 0)
+					handleStream(parsed);
 				
-				auto streamsItr = channel.find("streams");
+				// discard the stream, now that we're done with it
 				
-				if (streamsItr != channel.end())
+				return false;
+			}
+			return true;
+			
+		case json::parse_event_t::value:
+			if (depth == 5 && keys[5] == "frameCount" && isInFirstChannel() && parsed.is_number_integer())
+			{
+				streamKeys.reserve(std::max(0, parsed.get<int>()));
+			}
+			else if (depth == 6 && keys[5] == "frames" && keys[1] == "channels" && keys[3] == "streams")
+			{
+				if (channelIndex == 0)
 				{
-					auto & streams = streamsItr.value();
-					
-					std::cout << "found streams!" << std::endl;
-					
-					for (auto stream : streams)
+					if (parsed.is_number())
 					{
-						//std::cout << "Stream.." << std::endl;
-						
-						auto title = stringValue(stream, "title", "");
-						auto group = stringValue(stream, "group", "");
-						auto frameCount = intValue(stream, "frameCount", 0);
-						auto fps = intValue(stream, "fps", 0);
-						
-						std::cout << "stream: " << title << ", group: " << group << ", frameCount: " << frameCount << ", fps: " << fps << std::endl;
-						
-						if (title.empty())
-						{
-							logWarning("title not set. skipping!");
-							continue;
-						}
-						
-						if (group.empty())
-						{
-							logWarning("group not set. skipping!");
-							continue;
-						}
-						
-						if (frameCount <= 0)
-						{
-							logWarning("frameCount is zero. skipping!");
-							continue;
-						}
-						
-						if (fps <= 0)
-						{
-							logWarning("fps is zero. skipping!");
-							continue;
-						}
-						
-						if (title != "X" && title != "Y" && title != "Z")
-						{
-							logWarning("joint channel unknown. skipping!");
-							continue;
-						}
-						
-						//
-						
-						if (String::StartsWith(group, "V_"))
-						{
-							logDebug("skipping empty joint. it only contains zeroes! joint: %s", group.c_str());
-							continue;
-						}
-						
-						//
-						
-						MotionBankJoint & joint = joints[group];
-						
-						MotionBankChannel * jointChannel = nullptr;
-						
-						if (title == "X")
-							jointChannel = &joint.px;
-						if (title == "Y")
-							jointChannel = &joint.py;
-						if (title == "Z")
-							jointChannel = &joint.pz;
-						
-						jointChannel->keys.resize(frameCount);
-						
-						auto framesItr = stream.find("frames");
-						
-						if (framesItr != stream.end())
-						{
-							auto & frames = framesItr.value();
-							
-							//std::cout << "found frames!" << std::endl;
-							
-							int index = 0;
-							
-							float lastValue = 0.f;
-							
-							for (auto frame : frames)
-							{
-								float value;
-								
-								if (!frame.is_number())
-								{
-									//logDebug("value is not a number. using last value");
-									
-									value = lastValue;
-								}
-								else
-								{
-									value = frame.get<float>();
-									
-									lastValue = value;
-								}
-								
-								//std::cout << index << " : " << value << std::endl;
-								
-								if (index < frameCount)
-								{
-									jointChannel->keys[index].time = index / float(fps);
-									jointChannel->keys[index].value = value;
-								}
-								
-								index++;
-							}
-						}
+						lastValue = parsed.get<float>();
 					}
-				}
-				
-				break; // only go for first channel
-			}
+					else
+					{
+						//logDebug("value is not a number. using last value");
+					}
+					
+					streamKeys.push_back(MotionBankKey(0.f, lastValue));
+					
+					if ((streamKeys.size() & 0xffff) == 0)
+						updateProgress();
+				}
+				
+				return false;
+			}
+			return true;
+			
+		default:
+			return true;
+		}
+	}
+};
+
+bool MotionBankProvider::import(const char * filename, SDL_atomic_t * progress, SDL_atomic_t * cancel)
+{
+	joints.clear();
+	
+	cacheFile.close();
+	
+	try
+	{
+		std::ifstream file(filename, std::ios::in | std::ios::binary);
+		
+		if (!file.is_open())
+		{
+			logError("failed to open %s", filename);
+			return false;
 		}
+		
+		file.seekg(0, std::ios::end);
+		const int64_t fileSize = file.tellg();
+		file.seekg(0, std::ios::beg);
+		
+		MotionBankImportState state(*this, file, fileSize, progress, cancel);
+		
+		json::parse(file, [&](int depth, json::parse_event_t event, json & parsed) { return state.handleEvent(depth, event, parsed); });
+		
+		if (state.channelIndex < 0)
+			logWarning("%s: no channels found", filename);
 	}
 	catch (std::exception & e)
 	{
 		logError(e.what());
+		
+		joints.clear();
+		
 		return false;
 	}
 	
+	for (auto & nameAndJoint : joints)
+	{
+		MotionBankJoint & joint = nameAndJoint.second;
+		
+		joint.finalizeImport();
+	}
+	
+	if (progress != nullptr)
+		SDL_AtomicSet(progress, 1000);
+	
 	return true;
 }
 
@@ -356,19 +748,33 @@ bool MotionBankProvider::provide(const float time, MotionFrame & frame)
 			auto & name = nameAndJoint.first;
 			auto & joint = nameAndJoint.second;
 			
-			frame.points[index].name = &name;
+			frame.names[index] = &name;
 			
-			joint.px.seek(time);
-			joint.py.seek(time);
-			joint.pz.seek(time);
-			
-			frame.points[index].p[0] = joint.px.interp(time);
-			frame.points[index].p[1] = joint.py.interp(time);
-			frame.points[index].p[2] = joint.pz.interp(time);
-			
-			frame.points[index].v[0] = (joint.px.interp(time + eps) - joint.px.interp(time)) / eps;
-			frame.points[index].v[1] = (joint.py.interp(time + eps) - joint.py.interp(time)) / eps;
-			frame.points[index].v[2] = (joint.pz.interp(time + eps) - joint.pz.interp(time)) / eps;
+			if (joint.samples != nullptr)
+			{
+				float p[3];
+				float v[3];
+				
+				joint.sampleUniform(time, p, v);
+				
+				for (int c = 0; c < 3; ++c)
+				{
+					frame.p[c][index] = p[c];
+					frame.v[c][index] = v[c];
+				}
+			}
+			else
+			{
+				MotionBankChannel * channels[3] = { &joint.px, &joint.py, &joint.pz };
+				
+				for (int c = 0; c < 3; ++c)
+				{
+					channels[c]->seek(time);
+					
+					frame.p[c][index] = channels[c]->interp(time);
+					frame.v[c][index] = (channels[c]->interp(time + eps) - frame.p[c][index]) / eps;
+				}
+			}
 			
 			frame.numPoints++;
 			
@@ -391,22 +797,1202 @@ bool provideMotionData_Kinect(const float time, MotionFrame & frame)
 	return false;
 }
 
+static bool loadMotionBank(MotionBankProvider & provider, const std::string & filename, SDL_atomic_t * progress = nullptr, SDL_atomic_t * cancel = nullptr)
+{
+	const std::string cachedFilename = filename + ".cache";
+	
+	if (provider.load(cachedFilename.c_str(), filename.c_str()))
+		return true;
+	
+	if (provider.import(filename.c_str(), progress, cancel))
+	{
+		provider.save(cachedFilename.c_str(), filename.c_str());
+		
+		return true;
+	}
+	
+	return false;
+}
+
+//
+
+MotionBankLoader::MotionBankLoader()
+	: filename()
+	, provider(nullptr)
+	, thread(nullptr)
+{
+	SDL_AtomicSet(&isDone, 0);
+	SDL_AtomicSet(&progress, 0);
+	SDL_AtomicSet(&cancelRequested, 0);
+}
+
+MotionBankLoader::~MotionBankLoader()
+{
+	cancel();
+}
+
+void MotionBankLoader::begin(const char * _filename)
+{
+	cancel();
+	
+	filename = _filename;
+	
+	provider = new MotionBankProvider();
+	
+	SDL_AtomicSet(&isDone, 0);
+	SDL_AtomicSet(&progress, 0);
+	SDL_AtomicSet(&cancelRequested, 0);
+	
+	thread = SDL_CreateThread(threadMain, "MotionBankLoader", this);
+}
+
+void MotionBankLoader::cancel()
+{
+	if (thread == nullptr)
+		return;
+	
+	SDL_AtomicSet(&cancelRequested, 1);
+	
+	delete end();
+}
+
+bool MotionBankLoader::isFinished()
+{
+	return SDL_AtomicGet(&isDone) != 0;
+}
+
+int MotionBankLoader::getProgress() const
+{
+	return SDL_AtomicGet(const_cast<SDL_atomic_t*>(&progress));
+}
+
+MotionBankProvider * MotionBankLoader::end()
+{
+	Assert(thread != nullptr);
+	
+	SDL_WaitThread(thread, nullptr);
+	thread = nullptr;
+	
+	MotionBankProvider * result = provider;
+	provider = nullptr;
+	
+	return result;
+}
+
+int MotionBankLoader::threadMain(void * data)
+{
+	MotionBankLoader * self = (MotionBankLoader*)data;
+	
+	if (!loadMotionBank(*self->provider, self->filename, &self->progress, &self->cancelRequested))
+		logError("failed to load motion bank: %s", self->filename.c_str());
+	
+	SDL_AtomicSet(&self->isDone, 1);
+	
+	return 0;
+}
+
+//
+
+// resamples the recorded frames to a fixed rate. joints are linearly interpolated between the frames
+// surrounding each sample. joints which appear after the recording began are padded with their first
+// position, and joints which disappear keep their last position
+
+struct MotionBankRecordingState
+{
+	float sampleRate;
+	
+	std::vector<MotionBankSample> samples[MotionFrame::kNumPoints];
+	int numJoints;
+	int numSamples;
+	
+	MotionBankRecorder::Frame previousFrame;
+	bool hasPreviousFrame;
+	
+	MotionBankRecordingState(const float _sampleRate)
+		: sampleRate(_sampleRate)
+		, numJoints(0)
+		, numSamples(0)
+		, hasPreviousFrame(false)
+	{
+	}
+	
+	static MotionBankSample makeSample(const MotionBankRecorder::Frame & frame, const int index)
+	{
+		MotionBankSample s;
+		
+		s.p[0] = frame.p[0][index];
+		s.p[1] = frame.p[1][index];
+		s.p[2] = frame.p[2][index];
+		
+		return s;
+	}
+	
+	void addFrame(const MotionBankRecorder::Frame & frame)
+	{
+		if (hasPreviousFrame == false)
+		{
+			previousFrame = frame;
+			hasPreviousFrame = true;
+		}
+		
+		const MotionBankRecorder::Frame & a = previousFrame;
+		const MotionBankRecorder::Frame & b = frame;
+		
+		numJoints = std::max(numJoints, b.numPoints);
+		
+		for (;;)
+		{
+			// note : sample times are relative to the start of the recording, so replay starts at time zero
+			
+			const double sampleTime = numSamples / double(sampleRate);
+			
+			if (sampleTime > b.time)
+				break;
+			
+			const double duration = b.time - a.time;
+			
+			const float t = duration > 0.0 ? std::max(0.0, std::min(1.0, (sampleTime - a.time) / duration)) : 1.f;
+			
+			for (int i = 0; i < b.numPoints; ++i)
+			{
+				if ((int)samples[i].size() < numSamples)
+					samples[i].resize(numSamples, samples[i].empty() ? makeSample(b, i) : samples[i].back());
+				
+				MotionBankSample s = makeSample(b, i);
+				
+				if (i < a.numPoints)
+				{
+					for (int c = 0; c < 3; ++c)
+						s.p[c] = a.p[c][i] * (1.f - t) + b.p[c][i] * t;
+				}
+				
+				samples[i].push_back(s);
+			}
+			
+			numSamples++;
+		}
+		
+		previousFrame = frame;
+	}
+	
+	bool save(const char * filename)
+	{
+		if (numSamples == 0)
+		{
+			logWarning("%s: nothing was recorded", filename);
+			return false;
+		}
+		
+		MotionBankProvider provider;
+		
+		for (int i = 0; i < numJoints; ++i)
+		{
+			MotionBankSample zero;
+			memset(&zero, 0, sizeof(zero));
+			
+			samples[i].resize(numSamples, samples[i].empty() ? zero : samples[i].back());
+			
+			char name[32];
+			sprintf_s(name, sizeof(name), "joint%03d", i);
+			
+			MotionBankJoint & joint = provider.joints[name];
+			
+			joint.ownedSamples.swap(samples[i]);
+			joint.samples = &joint.ownedSamples[0];
+			joint.numSamples = numSamples;
+			joint.sampleRate = sampleRate;
+		}
+		
+		return provider.save(filename, nullptr);
+	}
+};
+
+MotionBankRecorder::MotionBankRecorder()
+	: filename()
+	, sampleRate(kDefaultSampleRate)
+	, ring(nullptr)
+	, thread(nullptr)
+	, startTime(0)
+{
+	SDL_AtomicSet(&recording, 0);
+	SDL_AtomicSet(&stopRequested, 0);
+}
+
+MotionBankRecorder::~MotionBankRecorder()
+{
+	end();
+	
+	wait();
+	
+	delete ring;
+	ring = nullptr;
+}
+
+bool MotionBankRecorder::begin(const char * _filename, const float _sampleRate)
+{
+	end();
+	
+	wait();
+	
+	if (_sampleRate <= 0.f)
+	{
+		logError("invalid sample rate: %g", _sampleRate);
+		return false;
+	}
+	
+	filename = _filename;
+	sampleRate = _sampleRate;
+	
+	if (ring == nullptr)
+		ring = new VfxMessageRing<Frame, kRingCapacity>();
+	
+	// drop frames which were recorded after the writer thread of the previous recording finished
+	
+	while (ring->claim(nullptr))
+		continue;
+	
+	startTime = SDL_GetPerformanceCounter();
+	
+	SDL_AtomicSet(&stopRequested, 0);
+	
+	thread = SDL_CreateThread(threadMain, "MotionBankRecorder", this);
+	
+	if (thread == nullptr)
+	{
+		logError("failed to create motion bank recorder thread: %s", SDL_GetError());
+		return false;
+	}
+	
+	SDL_AtomicSet(&recording, 1);
+	
+	return true;
+}
+
+void MotionBankRecorder::end()
+{
+	if (!isRecording())
+		return;
+	
+	SDL_AtomicSet(&recording, 0);
+	SDL_AtomicSet(&stopRequested, 1);
+}
+
+void MotionBankRecorder::wait()
+{
+	if (thread == nullptr)
+		return;
+	
+	SDL_WaitThread(thread, nullptr);
+	thread = nullptr;
+}
+
+void MotionBankRecorder::record(const MotionFrame & frame)
+{
+	if (!isRecording())
+		return;
+	
+	Frame * recordedFrame = ring->beginPush();
+	
+	if (recordedFrame != nullptr)
+	{
+		recordedFrame->time = (SDL_GetPerformanceCounter() - startTime) / double(SDL_GetPerformanceFrequency());
+		recordedFrame->numPoints = frame.numPoints;
+		
+		for (int c = 0; c < 3; ++c)
+			memcpy(recordedFrame->p[c], frame.p[c], frame.numPoints * sizeof(float));
+		
+		ring->endPush();
+	}
+}
+
+int MotionBankRecorder::threadMain(void * data)
+{
+	MotionBankRecorder * self = (MotionBankRecorder*)data;
+	
+	// note : the state is large and grows with the length of the recording, so it lives on the heap
+	
+	MotionBankRecordingState * state = new MotionBankRecordingState(self->sampleRate);
+	
+	Frame * frame = new Frame();
+	
+	const int numDroppedAtStart = self->ring->getNumDropped();
+	
+	for (;;)
+	{
+		// note : check whether to stop before draining the ring, so frames recorded before stopping aren't lost
+		
+		const bool stop = SDL_AtomicGet(&self->stopRequested) != 0;
+		
+		while (self->ring->pop(*frame))
+			state->addFrame(*frame);
+		
+		if (stop)
+			break;
+		
+		SDL_Delay(5);
+	}
+	
+	const int numDropped = self->ring->getNumDropped() - numDroppedAtStart;
+	
+	if (numDropped > 0)
+		logWarning("motion bank recorder dropped %d frames", numDropped);
+	
+	if (state->save(self->filename.c_str()))
+		logDebug("recorded %d samples to %s", state->numSamples, self->filename.c_str());
+	else
+		logError("failed to save motion bank recording: %s", self->filename.c_str());
+	
+	delete frame;
+	frame = nullptr;
+	
+	delete state;
+	state = nullptr;
+	
+	return 0;
+}
+
+static Mat4x4 getMotionBankTransform()
+{
+	const float s = .2f;
+	const float d2r = Calc::DegToRad(1.f);
+	
+	return Mat4x4(true).RotateX(d2r * 90.f).RotateY(d2r * 180.f).Scale(s, s, s);
+}
+
+// transforms the points into the desired coordinate frame and analyzes the frame in a single pass over the
+// points, four points at a time. points with NaN coordinates are left out of the analysis and the live data
+
+static_assert(MotionFrame::kNumPoints <= kMaxJoints, "live data must be able to hold all points of a motion frame");
+
+static void analyzeMotionFrame(MotionFrame & frame, const Mat4x4 & transform, MotionFrameAnalysis & analysis)
+{
+	float min[3] = { +FLT_MAX, +FLT_MAX, +FLT_MAX };
+	float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	
+	int numValidPoints = 0;
+	
+#if CCL_USE_SSE
+	__m128 m4[4][3];
+	
+	for (int i = 0; i < 4; ++i)
+		for (int c = 0; c < 3; ++c)
+			m4[i][c] = _mm_set1_ps(transform(i, c));
+	
+	__m128 min4[3];
+	__m128 max4[3];
+	
+	for (int c = 0; c < 3; ++c)
+	{
+		min4[c] = _mm_set1_ps(+FLT_MAX);
+		max4[c] = _mm_set1_ps(-FLT_MAX);
+	}
+	
+	const __m128 laneIndex4 = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+	const __m128 numPoints4 = _mm_set1_ps(frame.numPoints);
+	
+	for (int i = 0; i < frame.numPoints; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(frame.p[0] + i);
+		const __m128 y = _mm_loadu_ps(frame.p[1] + i);
+		const __m128 z = _mm_loadu_ps(frame.p[2] + i);
+		
+		__m128 t[3];
+		
+		for (int c = 0; c < 3; ++c)
+		{
+			t[c] = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(m4[0][c], x), _mm_mul_ps(m4[1][c], y)),
+				_mm_add_ps(_mm_mul_ps(m4[2][c], z), m4[3][c]));
+			
+			_mm_storeu_ps(frame.p[c] + i, t[c]);
+		}
+		
+		// note : the lanes past the last point are masked out, as are points with NaN coordinates
+		
+		const __m128 isValid = _mm_and_ps(
+			_mm_and_ps(_mm_cmpord_ps(t[0], t[0]), _mm_cmpord_ps(t[1], t[1])),
+			_mm_and_ps(_mm_cmpord_ps(t[2], t[2]), _mm_cmplt_ps(_mm_add_ps(laneIndex4, _mm_set1_ps(i)), numPoints4)));
+		
+		for (int c = 0; c < 3; ++c)
+		{
+			min4[c] = _mm_min_ps(min4[c], _mm_or_ps(_mm_and_ps(isValid, t[c]), _mm_andnot_ps(isValid, _mm_set1_ps(+FLT_MAX))));
+			max4[c] = _mm_max_ps(max4[c], _mm_or_ps(_mm_and_ps(isValid, t[c]), _mm_andnot_ps(isValid, _mm_set1_ps(-FLT_MAX))));
+		}
+		
+		const int validBits = _mm_movemask_ps(isValid);
+		
+		for (int k = 0; k < 4; ++k)
+		{
+			if (validBits & (1 << k))
+			{
+				env.liveData.x[numValidPoints] = frame.p[xIndex][i + k];
+				env.liveData.y[numValidPoints] = frame.p[yIndex][i + k];
+				
+				numValidPoints++;
+			}
+		}
+	}
+	
+	for (int c = 0; c < 3; ++c)
+	{
+		float minLanes[4];
+		float maxLanes[4];
+		
+		_mm_storeu_ps(minLanes, min4[c]);
+		_mm_storeu_ps(maxLanes, max4[c]);
+		
+		min[c] = std::min(std::min(minLanes[0], minLanes[1]), std::min(minLanes[2], minLanes[3]));
+		max[c] = std::max(std::max(maxLanes[0], maxLanes[1]), std::max(maxLanes[2], maxLanes[3]));
+	}
+#else
+	for (int i = 0; i < frame.numPoints; ++i)
+	{
+		const Vec3 p = transform * Vec3(frame.p[0][i], frame.p[1][i], frame.p[2][i]);
+		
+		frame.p[0][i] = p[0];
+		frame.p[1][i] = p[1];
+		frame.p[2][i] = p[2];
+		
+		if (isnan(p[0]) || isnan(p[1]) || isnan(p[2]))
+			continue;
+		
+		for (int c = 0; c < 3; ++c)
+		{
+			min[c] = std::min(min[c], p[c]);
+			max[c] = std::max(max[c], p[c]);
+		}
+		
+		env.liveData.x[numValidPoints] = p[xIndex];
+		env.liveData.y[numValidPoints] = p[yIndex];
+		
+		numValidPoints++;
+	}
+#endif
+	
+	env.liveData.numPoints = numValidPoints;
+	
+	// todo : calculate metrics related to posture, movement speed, and whatnot
+	
+	analysis = MotionFrameAnalysis();
+	
+	if (numValidPoints > 0)
+	{
+		env.liveData.min[0] = min[xIndex];
+		env.liveData.min[1] = min[yIndex];
+		env.liveData.max[0] = max[xIndex];
+		env.liveData.max[1] = max[yIndex];
+		
+		env.collisionY = env.liveData.max[1];
+		
+		const float kWidenessBegin = 100.f;
+		const float kWidenessEnd = 200.f;
+		const float kNarrownessBegin = 100.f;
+		const float kNarrownessEnd = 50.f;
+		const float kTallnessBegin = 300.f;
+		const float kTallnessEnd = 360.f;
+		const float kSmallnessBegin = 300.f;
+		const float kSmallnessEnd = 200.f;
+		
+		for (int i = 0; i < 3; ++i)
+		{
+			analysis.min[i] = min[i];
+			analysis.max[i] = max[i];
+			
+			analysis.size[i] = max[i] - min[i];
+			analysis.sizeRcp[i] = 1.f / (max[i] - min[i] + eps);
+		}
+		
+		analysis.xOverY = analysis.size[xIndex] / (analysis.size[yIndex] + eps);
+		
+		analysis.wideness = std::max(0.f, std::min(1.f, (analysis.size[xIndex] - kWidenessBegin) / (kWidenessEnd - kWidenessBegin)));
+		analysis.narrowness = std::max(0.f, std::min(1.f, (analysis.size[xIndex] - kNarrownessBegin) / (kNarrownessEnd - kNarrownessBegin)));
+		
+		analysis.tallness = std::max(0.f, std::min(1.f, (analysis.size[yIndex] - kTallnessBegin) / (kTallnessEnd - kTallnessBegin)));
+		analysis.smallness = std::max(0.f, std::min(1.f, (analysis.size[yIndex] - kSmallnessBegin) / (kSmallnessEnd - kSmallnessBegin)));
+	}
+}
+
+//
+
+static void cclParallelFor(VfxScheduler * scheduler, VfxJobFunction function, void * data, const int numItems)
+{
+	// note : the population is ticked from within the CCL node, which may itself run on one of the workers of the
+	//        graph's scheduler. the scheduler supports nested jobs, so we share its threads rather than starting
+	//        threads of our own
+	
+	if (scheduler != nullptr)
+		scheduler->parallelFor(function, data, numItems);
+	else
+	{
+		for (int i = 0; i < numItems; ++i)
+			function(data, i);
+	}
+}
+
+struct CclPopulationTickJob
+{
+	Dancer * dancers;
+	float dt;
+	int numSteps;
+	FitnessFunction fitnessFunction;
+	
+	static void process(void * data, const int index)
+	{
+		const CclPopulationTickJob * job = (CclPopulationTickJob*)data;
+		
+		Dancer & d = job->dancers[index];
+		
+		for (int s = 0; s < job->numSteps; ++s)
+		{
+			d.tick(job->dt, job->fitnessFunction);
+		}
+	}
+};
+
+struct CclBreedJob
+{
+	static const int kBreedingPoolSize = 1000;
+	
+	Dancer * nextGeneration;
+	const Dancer * bestDancer;
+	const Dancer * breedingPool[kBreedingPoolSize];
+	const uint64_t * seeds;
+	
+	static void process(void * data, const int index)
+	{
+		const CclBreedJob * job = (CclBreedJob*)data;
+		
+		// note : each child has its own random number generator, seeded up front on the calling thread, so the
+		//        outcome doesn't depend on the order in which the children are bred
+		
+		DancerRandom rng;
+		rng.seed(job->seeds[index]);
+		
+		for (;;)
+		{
+			const int index1 = rng.nextInt(kBreedingPoolSize);
+			const int index2 = rng.nextInt(kBreedingPoolSize);
+			
+			const Dancer * d1 = job->breedingPool[index1];
+			const Dancer * d2 = job->breedingPool[index2];
+			
+			if (d1 == d2)
+				continue;
+			else
+			{
+				Dancer & n = job->nextGeneration[index];
+				
+				CclPopulation::breed(n, *job->bestDancer, *d1, *d2, rng.next());
+				
+				CclPopulation::mutate(n);
+				
+				break;
+			}
+		}
+	}
+};
+
+CclPopulation::CclPopulation()
+	: dancers()
+	, nextGeneration()
+	, fittestDancer()
+	, timeToNextGeneration(3.0)
+	, timeToNextFitnessFunction(0.0)
+	, fitnessFunction(kFitnessFunction_GetSmall)
+	, generation(0)
+	, rng()
+	, scheduler(nullptr)
+{
+}
+
+void CclPopulation::init(const int size, const uint64_t seed)
+{
+	dancers.clear();
+	
+	rng.seed(seed);
+	
+	resize(size);
+	
+	fittestDancer = dancers[0];
+	
+	generation = 0;
+}
+
+void CclPopulation::resize(const int size)
+{
+	const int oldSize = dancers.size();
+	
+	dancers.resize(size);
+	
+	for (int i = oldSize; i < size; ++i)
+	{
+		Dancer & d = dancers[i];
+		
+		d.rng.seed(rng.next());
+		d.randomize();
+	}
+}
+
+void CclPopulation::updateFitnessFunction(const double dt)
+{
+	timeToNextFitnessFunction -= dt;
+	
+	if (timeToNextFitnessFunction <= 0.0)
+	{
+		timeToNextFitnessFunction = 10.0;
+		
+		fitnessFunction = (FitnessFunction)rng.nextInt(kFitnessFunction_COUNT);
+	}
+}
+
+void CclPopulation::tick(const float dt, const int numSteps)
+{
+	int step = 0;
+	
+	while (step < numSteps)
+	{
+		timeToNextGeneration -= dt;
+		
+		if (timeToNextGeneration <= 0.0)
+		{
+			timeToNextGeneration = 5.0;
+			
+			calculateNextGeneration();
+		}
+		
+		// the dancers are independent of each other until the next generation is bred, so each of them can run
+		// all of the steps up to that point in one go
+		
+		int numStepsUntilNextGeneration = 1;
+		
+		while (step + numStepsUntilNextGeneration < numSteps && timeToNextGeneration - dt > 0.0)
+		{
+			timeToNextGeneration -= dt;
+			
+			numStepsUntilNextGeneration++;
+		}
+		
+		tickDancers(dt, numStepsUntilNextGeneration);
+		
+		step += numStepsUntilNextGeneration;
+	}
+}
+
+void CclPopulation::tickDancers(const float dt, const int numSteps)
+{
+	CclPopulationTickJob job;
+	job.dancers = &dancers[0];
+	job.dt = dt;
+	job.numSteps = numSteps;
+	job.fitnessFunction = fitnessFunction;
+	
+	cclParallelFor(scheduler, CclPopulationTickJob::process, &job, dancers.size());
+}
+
+bool CclPopulation::calculateNextGeneration()
+{
+	const int kBreedingPoolSize = CclBreedJob::kBreedingPoolSize;
+	
+	CclBreedJob job;
+	
+	const Dancer ** breedingPool = job.breedingPool;
+	
+	const int populationSize = dancers.size();
+	
+	Dancer * bestDancer = &dancers[0];
+	
+	for (int i = 1; i < populationSize; ++i)
+	{
+		Dancer & d = dancers[i];
+		
+		if (d.totalFitnessValue > bestDancer->totalFitnessValue)
+			bestDancer = &d;
+	}
+		
+	double totalFitness = 0.0;
+	
+	for (int i = 0; i < populationSize; ++i)
+	{
+		Dancer & d = dancers[i];
+		
+		totalFitness += d.totalFitnessValue;
+	}
+	
+	if (totalFitness == 0)
+	{
+		logDebug("total fitness value is zero. no sense in breeding!");
+		return false;
+	}
+	
+	double currentTotal = 0.0;
+	
+	int index1 = 0;
+	
+	for (int i = 0; i < populationSize; ++i)
+	{
+		Dancer & d = dancers[i];
+		
+		currentTotal += d.totalFitnessValue;
+		
+		const int index2 = std::min(int(currentTotal / totalFitness * kBreedingPoolSize), kBreedingPoolSize);
+		
+		//logDebug("filling %d - %d", index1, index2);
+		
+		for (int index = index1; index < index2; ++index)
+		{
+			breedingPool[index] = &d;
+		}
+		
+		index1 = index2;
+	}
+	
+	Assert(index1 == kBreedingPoolSize);
+	
+	if (breedingPool[0] == breedingPool[kBreedingPoolSize - 1])
+	{
+		logDebug("only one unique element in breeding pool. cannot self-breed so skipping breeding phase!");
+		return false;
+	}
+	
+	//
+	
+	//logDebug("breeding!");
+	
+	nextGeneration.resize(populationSize);
+	
+	std::vector<uint64_t> seeds;
+	seeds.resize(populationSize);
+	
+	for (auto & seed : seeds)
+		seed = rng.next();
+	
+	job.nextGeneration = &nextGeneration[0];
+	job.bestDancer = bestDancer;
+	job.seeds = &seeds[0];
+	
+	cclParallelFor(scheduler, CclBreedJob::process, &job, populationSize);
+	
+	fittestDancer = *bestDancer;
+	
+	dancers.swap(nextGeneration);
+	
+	generation++;
+	
+	return true;
+}
+
+void CclPopulation::breed(Dancer & d, const Dancer & o, const Dancer & d1, const Dancer & d2, const uint64_t seed)
+{
+	d = o;
+	
+	d.totalFitnessValue = 0.0;
+	
+	d.rng.seed(seed);
+	
+	// note : the parents may have a different topology than the best dancer, when the population was just
+	//        randomized. a parent like that passes on the springs of the best dancer instead of its own
+	
+	const Dancer & p1 = d1.hasSameTopology(o) ? d1 : o;
+	const Dancer & p2 = d2.hasSameTopology(o) ? d2 : o;
+	
+#if 1
+	for (int i = 0; i < o.numSprings; ++i)
+	{
+		DancerSpring & s = d.springs[i];
+		const DancerSpring & s1 = p1.springs[i];
+		const DancerSpring & s2 = p2.springs[i];
+		
+		s.spasmFrequency = Calc::Lerp(s1.spasmFrequency, s2.spasmFrequency, d.rng.nextDouble(0.0, 1.0));
+		s.springFactor = Calc::Lerp(s1.springFactor, s2.springFactor, d.rng.nextDouble(0.0, 1.0));
+	}
+#endif
+}
+
+void CclPopulation::mutate(Dancer & d)
+{
+	for (int i = 0; i < d.numSprings; ++i)
+	{
+		DancerSpring & s = d.springs[i];
+		
+		s.spasmFrequency += d.rng.nextDouble(-0.1, +0.1);
+		s.springFactor += d.rng.nextDouble(-5.0, +5.0);
+		
+		s.spasmFrequency = std::max(0.0, s.spasmFrequency);
+		s.springFactor = std::max(0.0, s.springFactor);
+		
+		//s.desiredDistance += random(-1.0, +1.0) * 10.0;
+		s.desiredDistance += d.rng.nextDouble(-1.0, +1.0) * 50.0;
+		s.desiredDistance = std::max(s.desiredDistance, 0.0);
+		s.desiredDistance = std::min(s.desiredDistance, s.maximumDistance);
+	}
+}
+
+// checkpoints store the members of each dancer, followed by the joints and springs which are in use. the spring
+// slots are recalculated on load rather than stored, so the batched solver can rely on them being well formed.
+// the joint and spring sizes are stored along with them, so a checkpoint written by a build with a different
+// joint or spring layout is rejected instead of being misread
+
+static const int32_t kCheckpointMagic = 'C' | ('C' << 8) | ('L' << 16) | ('P' << 24);
+static const int32_t kCheckpointVersion = 4;
+
+static void writeDancer(StreamWriter & writer, const Dancer & d)
+{
+	writer.WriteInt32(d.numJoints);
+	writer.WriteInt32(d.numSprings);
+	
+	writer.WriteBytes(&d.dampeningPerSecond, sizeof(d.dampeningPerSecond));
+	writer.WriteBytes(&d.accelTowardsOtherDancer, sizeof(d.accelTowardsOtherDancer));
+	writer.WriteBytes(d.min, sizeof(d.min));
+	writer.WriteBytes(d.max, sizeof(d.max));
+	writer.WriteBytes(&d.totalFitnessValue, sizeof(d.totalFitnessValue));
+	writer.WriteBytes(&d.rng, sizeof(d.rng));
+	
+	writer.WriteBytes(d.joints.data(), sizeof(DancerJoint) * d.numJoints);
+	writer.WriteBytes(d.springs.data(), sizeof(DancerSpring) * d.numSprings);
+}
+
+static bool readDancer(StreamReader & reader, Dancer & d)
+{
+	d.numJoints = reader.ReadInt32();
+	d.numSprings = reader.ReadInt32();
+	
+	if (d.numJoints < 0 || d.numJoints > kMaxJoints ||
+		d.numSprings < 0 || d.numSprings > kMaxSprings)
+	{
+		return false;
+	}
+	
+	reader.ReadBytes(&d.dampeningPerSecond, sizeof(d.dampeningPerSecond));
+	reader.ReadBytes(&d.accelTowardsOtherDancer, sizeof(d.accelTowardsOtherDancer));
+	reader.ReadBytes(d.min, sizeof(d.min));
+	reader.ReadBytes(d.max, sizeof(d.max));
+	reader.ReadBytes(&d.totalFitnessValue, sizeof(d.totalFitnessValue));
+	reader.ReadBytes(&d.rng, sizeof(d.rng));
+	
+	d.joints.resize(d.numJoints);
+	d.springs.resize(d.numSprings);
+	
+	reader.ReadBytes(d.joints.data(), sizeof(DancerJoint) * d.numJoints);
+	reader.ReadBytes(d.springs.data(), sizeof(DancerSpring) * d.numSprings);
+	
+	// the solvers index the joints without checking, so make sure the indices are in range. each pair of
+	// joints may be connected at most once, which bounds the number of colors calculateSpringSlots needs
+	
+	static const int kNumConnectionWords = kMaxJoints / 64;
+	
+	uint64_t connections[kMaxJoints][kNumConnectionWords];
+	memset(connections, 0, sizeof(connections));
+	
+	for (auto & s : d.springs)
+	{
+		const int i = s.jointIndex1;
+		const int j = s.jointIndex2;
+		
+		if (i < 0 || i >= d.numJoints ||
+			j < 0 || j >= d.numJoints ||
+			i == j ||
+			(connections[i][j / 64] & (uint64_t(1) << (j % 64))))
+		{
+			return false;
+		}
+		
+		connections[i][j / 64] |= uint64_t(1) << (j % 64);
+		connections[j][i / 64] |= uint64_t(1) << (i % 64);
+	}
+	
+	d.calculateSpringSlots();
+	
+	return true;
+}
+
+bool CclPopulation::saveCheckpoint(const char * filename) const
+{
+	try
+	{
+		FileStream stream;
+		stream.Open(filename, OpenMode_Write);
+		StreamWriter writer(&stream, false);
+		
+		writer.WriteInt32(kCheckpointMagic);
+		writer.WriteInt32(kCheckpointVersion);
+		writer.WriteInt32(sizeof(DancerJoint));
+		writer.WriteInt32(sizeof(DancerSpring));
+		
+		writer.WriteInt32(dancers.size());
+		writer.WriteInt32(generation);
+		writer.WriteInt32(fitnessFunction);
+		writer.WriteBytes(&timeToNextGeneration, sizeof(timeToNextGeneration));
+		writer.WriteBytes(&timeToNextFitnessFunction, sizeof(timeToNextFitnessFunction));
+		writer.WriteBytes(&rng, sizeof(rng));
+		
+		writeDancer(writer, fittestDancer);
+		
+		for (auto & d : dancers)
+			writeDancer(writer, d);
+		
+		return true;
+	}
+	catch (std::exception & e)
+	{
+		logError(e.what());
+		
+		return false;
+	}
+}
+
+bool CclPopulation::loadCheckpoint(const char * filename)
+{
+	try
+	{
+		FileStream stream;
+		stream.Open(filename, OpenMode_Read);
+		StreamReader reader(&stream, false);
+		
+		const int magic = reader.ReadInt32();
+		const int version = reader.ReadInt32();
+		
+		if (magic != kCheckpointMagic || version != kCheckpointVersion)
+		{
+			logError("%s: checkpoint is incompatible with this version of the dancer", filename);
+			return false;
+		}
+		
+		const int jointSize = reader.ReadInt32();
+		const int springSize = reader.ReadInt32();
+		
+		if (jointSize != sizeof(DancerJoint) || springSize != sizeof(DancerSpring))
+		{
+			logError("%s: checkpoint is incompatible with this version of the dancer", filename);
+			return false;
+		}
+		
+		const int numDancers = reader.ReadInt32();
+		
+		if (numDancers < 2 || numDancers > kMaxSize)
+		{
+			logError("%s: invalid population size: %d", filename, numDancers);
+			return false;
+		}
+		
+		// note : read everything into temporaries first, so a truncated file leaves the population untouched
+		
+		const int newGeneration = reader.ReadInt32();
+		const FitnessFunction newFitnessFunction = (FitnessFunction)reader.ReadInt32();
+		
+		double newTimeToNextGeneration;
+		double newTimeToNextFitnessFunction;
+		DancerRandom newRng;
+		
+		reader.ReadBytes(&newTimeToNextGeneration, sizeof(newTimeToNextGeneration));
+		reader.ReadBytes(&newTimeToNextFitnessFunction, sizeof(newTimeToNextFitnessFunction));
+		reader.ReadBytes(&newRng, sizeof(newRng));
+		
+		Dancer newFittestDancer;
+		std::vector<Dancer> newDancers;
+		newDancers.resize(numDancers);
+		
+		if (!readDancer(reader, newFittestDancer))
+		{
+			logError("%s: checkpoint contains an invalid dancer", filename);
+			return false;
+		}
+		
+		for (auto & d : newDancers)
+		{
+			if (!readDancer(reader, d))
+			{
+				logError("%s: checkpoint contains an invalid dancer", filename);
+				return false;
+			}
+		}
+		
+		if (newFitnessFunction < 0 || newFitnessFunction >= kFitnessFunction_COUNT)
+		{
+			logError("%s: invalid fitness function: %d", filename, newFitnessFunction);
+			return false;
+		}
+		
+		dancers.swap(newDancers);
+		fittestDancer = newFittestDancer;
+		generation = newGeneration;
+		fitnessFunction = newFitnessFunction;
+		timeToNextGeneration = newTimeToNextGeneration;
+		timeToNextFitnessFunction = newTimeToNextFitnessFunction;
+		rng = newRng;
+		
+		return true;
+	}
+	catch (std::exception & e)
+	{
+		logError(e.what());
+		
+		return false;
+	}
+}
+
+//
+
+bool CclEvolveSettings::parse(const char * keyValue)
+{
+	const char * separator = strchr(keyValue, '=');
+	
+	if (separator == nullptr)
+		return false;
+	
+	const std::string key(keyValue, separator);
+	const std::string value(separator + 1);
+	
+	if (key == "motionbank")
+		motionBankFilename = value;
+	else if (key == "checkpoint")
+		checkpointFilename = value;
+	else if (key == "duration")
+		duration = Parse::Float(value);
+	else if (key == "interval")
+		checkpointInterval = Parse::Float(value);
+	else if (key == "dt")
+		dt = Parse::Float(value);
+	else if (key == "speed")
+		replaySpeed = Parse::Float(value);
+	else if (key == "population")
+		populationSize = Parse::Int32(value);
+	else if (key == "steps")
+		generationSteps = Parse::Int32(value);
+	else if (key == "seed")
+		seed = Parse::UInt32(value);
+	else if (key == "connectivity")
+		bodyConnectivity = Parse::Int32(value);
+	else if (key == "distance")
+		bodyDistance = Parse::Float(value);
+	else if (key == "gravity")
+		envGravity = Parse::Float(value);
+	else if (key == "factorX")
+		envFactorX = Parse::Float(value);
+	else if (key == "factorY")
+		envFactorY = Parse::Float(value);
+	else if (key == "spasms")
+		envUseSpasms = Parse::Bool(value);
+	else if (key == "springs")
+		envUseSprings = Parse::Bool(value);
+	else if (key == "distanceConstraint")
+		envUseDistanceConstraint = Parse::Bool(value);
+	else
+		return false;
+	
+	return true;
+}
+
+bool evolvePopulation_MotionBank(const CclEvolveSettings & settings)
+{
+	if (settings.checkpointFilename.empty())
+	{
+		logError("no checkpoint filename given");
+		return false;
+	}
+	
+	if (settings.dt <= 0.f)
+	{
+		logError("invalid time step: %f", settings.dt);
+		return false;
+	}
+	
+	MotionBankProvider provider;
+	
+	if (!loadMotionBank(provider, settings.motionBankFilename))
+	{
+		logError("failed to load motion bank: %s", settings.motionBankFilename.c_str());
+		return false;
+	}
+	
+	env.numConnectedJoints = settings.bodyConnectivity;
+	env.maxDistanceFactor = settings.bodyDistance;
+	env.gravityY = settings.envGravity;
+	env.xFactor = settings.envFactorX;
+	env.yFactor = settings.envFactorY;
+	env.useSpasms = settings.envUseSpasms;
+	env.useSprings = settings.envUseSprings;
+	env.useDistanceConstraint = settings.envUseDistanceConstraint;
+	
+	xIndex = 0;
+	yIndex = 2;
+	
+	const Mat4x4 transform = getMotionBankTransform();
+	
+	// evaluate and breed the dancers using one worker thread per additional core
+	
+	VfxScheduler scheduler;
+	scheduler.init(std::max(0, SDL_GetCPUCount() - 1));
+	
+	CclPopulation population;
+	
+	population.scheduler = &scheduler;
+	
+	population.init(std::max(2, std::min(settings.populationSize, CclPopulation::kMaxSize)), settings.seed);
+	
+	const int numFrames = int(std::ceil(settings.duration / settings.dt));
+	
+	const uint32_t startTime = SDL_GetTicks();
+	
+	float time = 0.f;
+	
+	double timeToNextCheckpoint = settings.checkpointInterval;
+	
+	MotionFrame motionFrame;
+	MotionFrameAnalysis analysis;
+	
+	for (int i = 0; i < numFrames; ++i)
+	{
+		time += settings.dt * settings.replaySpeed;
+		
+		motionFrame = MotionFrame();
+		
+		provideMotionData_MotionBank(time, provider, motionFrame);
+		
+		analyzeMotionFrame(motionFrame, transform, analysis);
+		
+		population.updateFitnessFunction(settings.dt);
+		
+		population.tick(settings.dt, settings.generationSteps);
+		
+		timeToNextCheckpoint -= settings.dt;
+		
+		if (timeToNextCheckpoint <= 0.0 && settings.checkpointInterval > 0.0)
+		{
+			timeToNextCheckpoint = settings.checkpointInterval;
+			
+			if (!population.saveCheckpoint(settings.checkpointFilename.c_str()))
+				return false;
+			
+			logDebug("evolved %.1f seconds in %.1f seconds. generation %d", (i + 1) * settings.dt, (SDL_GetTicks() - startTime) / 1000.0, population.generation);
+		}
+	}
+	
+	if (!population.saveCheckpoint(settings.checkpointFilename.c_str()))
+		return false;
+	
+	logDebug("evolved %.1f seconds in %.1f seconds. generation %d", numFrames * settings.dt, (SDL_GetTicks() - startTime) / 1000.0, population.generation);
+	
+	return true;
+}
+
 //
 
 VfxNodeCCL::VfxNodeCCL()
 	: VfxNodeBase()
-	, provider()
+	, provider(nullptr)
+	, providerLoader()
+	, recorder()
 	, surface(nullptr)
 	, outputImage(nullptr)
-	, dancer()
-	, timeToNextGeneration(3.0)
-	, timeToNextFitnessFunction(0.0)
-	, currentFitnessFunction(kFitnessFunction_GetSmall)
+	, population()
 	, filename()
+	, checkpointFilename()
 	, time(0.f)
 	, motionFrame()
 	, analysis()
 {
+	provider = new MotionBankProvider();
+	
 	surface = new Surface(GFX_SX, GFX_SY, false);
 	
 	outputImage = new VfxImage_Texture();
@@ -424,7 +2010,7 @@ VfxNodeCCL::VfxNodeCCL()
 	addInput(kInput_FixedJoint, kVfxPlugType_Int);
 	addInput(kInput_UseOsc, kVfxPlugType_Bool);
 	addInput(kInput_OscTrigger, kVfxPlugType_Trigger);
-	addInput(kInput_OscValues, kVfxPlugType_String);
+	addInput(kInput_OscValues, kVfxPlugType_FloatArray);
 	addInput(kInput_OscScale, kVfxPlugType_Float);
 	addInput(kInput_ShowGeneticDancers, kVfxPlugType_Bool);
 	addInput(kInput_VisualDancerBlendPerSecond, kVfxPlugType_Float);
@@ -440,17 +2026,24 @@ VfxNodeCCL::VfxNodeCCL()
 	addInput(kInput_EnvUseSprings, kVfxPlugType_Bool);
 	addInput(kInput_EnvUseDistanceConstraint, kVfxPlugType_Bool);
 	addInput(kInput_ShowMotionData, kVfxPlugType_Bool);
+	addInput(kInput_PopulationSize, kVfxPlugType_Int);
+	addInput(kInput_GenerationSteps, kVfxPlugType_Int);
+	addInput(kInput_Checkpoint, kVfxPlugType_String);
+	addInput(kInput_Record, kVfxPlugType_Bool);
+	addInput(kInput_RecordFilename, kVfxPlugType_String);
 	
 	addOutput(kOutput_Image, kVfxPlugType_Image, outputImage);
 	
+	// note : tick stays on the main thread, as it writes the dancer environment and the axis indices shared by
+	//        all ccl nodes, and reads the keyboard. the bulk of the work, ticking and breeding the population,
+	//        is spread over the worker threads of the graph's scheduler by the population itself
+	
+	population.init(CclPopulation::kDefaultSize, rand());
+	
+	currentDancer.rng.seed(population.rng.next());
 	currentDancer.randomize();
 	currentDancerSlow = currentDancer;
-	fittestDancer = currentDancer;
-	
-	for (int i = 0; i < kNumDancers; ++i)
-	{
-		dancer[i].randomize();
-	}
+	population.fittestDancer = currentDancer;
 }
 
 VfxNodeCCL::~VfxNodeCCL()
@@ -460,6 +2053,11 @@ VfxNodeCCL::~VfxNodeCCL()
 	
 	delete surface;
 	surface = nullptr;
+	
+	providerLoader.cancel();
+	
+	delete provider;
+	provider = nullptr;
 }
 
 void VfxNodeCCL::tick(const float dt)
@@ -467,9 +2065,10 @@ void VfxNodeCCL::tick(const float dt)
 	const double blendToPerSecond = getInputFloat(kInput_VisualDancerBlendPerSecond, 0.f);
 	const double blendToThisFrame = 1.0 - std::pow(1.0 - blendToPerSecond, dt);
 	const char * newFilename = getInputString(kInput_Filename, "");
+	const char * newCheckpointFilename = getInputString(kInput_Checkpoint, "");
 	const bool useOsc = getInputBool(kInput_UseOsc, false);
     //const int fitnessFunction = getInputInt(kInput_FitnessFunction, 0);
-	const FitnessFunction fitnessFunction = currentFitnessFunction;
+	const FitnessFunction fitnessFunction = population.fitnessFunction;
 	const int bodyConnectivity = getInputInt(kInput_BodyConnectivity, 4);
 	const float bodyDistance = getInputFloat(kInput_BodyDistance, 1.f);
 	const float envGravity = getInputFloat(kInput_EnvGravity, 0.f);
@@ -490,18 +2089,56 @@ void VfxNodeCCL::tick(const float dt)
 	
 	// reload data, if necessary
 	
+	// note : motion banks are loaded in the background. the current motion bank stays in use until the new one has finished loading
+	
 	if (newFilename != filename)
 	{
 		filename = newFilename;
 		
-		std::string cachedFilename = filename + ".cache";
+		providerLoader.cancel();
 		
-		if (!provider.load(cachedFilename.c_str()))
+		if (filename.empty())
 		{
-			if (provider.import(filename.c_str()))
-			{
-				provider.save(cachedFilename.c_str());
-			}
+			delete provider;
+			provider = new MotionBankProvider();
+		}
+		else
+		{
+			providerLoader.begin(filename.c_str());
+		}
+	}
+	
+	if (providerLoader.isBusy() && providerLoader.isFinished())
+	{
+		delete provider;
+		provider = providerLoader.end();
+	}
+	
+	// record the live input. the recording is written as a motion bank cache, so it can be replayed by
+	// setting the filename to the record filename
+	
+	const bool record = getInputBool(kInput_Record, false) && useOsc;
+	const char * recordFilename = getInputString(kInput_RecordFilename, "");
+	
+	if (record && !recorder.isRecording() && recordFilename[0] != 0)
+	{
+		recorder.begin((std::string(recordFilename) + ".cache").c_str());
+	}
+	else if (!record && recorder.isRecording())
+	{
+		recorder.end();
+	}
+	
+	// start from a population evolved ahead of time, if set
+	
+	if (newCheckpointFilename != checkpointFilename)
+	{
+		checkpointFilename = newCheckpointFilename;
+		
+		if (!checkpointFilename.empty() && population.loadCheckpoint(checkpointFilename.c_str()))
+		{
+			currentDancer = population.fittestDancer;
+			currentDancerSlow = currentDancer;
 		}
 	}
 	
@@ -532,33 +2169,17 @@ void VfxNodeCCL::tick(const float dt)
 	}
 	else
 	{
-		provideMotionData_MotionBank(time, provider, motionFrame);
+		provideMotionData_MotionBank(time, *provider, motionFrame);
 		
-		const float s = .2f;
-		const float d2r = Calc::DegToRad(1.f);
-		
-		transform = Mat4x4(true).RotateX(d2r * 90.f).RotateY(d2r * 180.f).Scale(s, s, s);
+		transform = getMotionBankTransform();
 		
 		xIndex = 0;
 		yIndex = 2;
 	}
 	
-	// transform the points into the desired coordinate frame
-	
-	for (int i = 0; i < motionFrame.numPoints; ++i)
-	{
-		MotionPoint & mp = motionFrame.points[i];
-		
-		const Vec3 p = transform * Vec3(mp.p[0], mp.p[1], mp.p[2]);
-		
-		mp.p[0] = p[0];
-		mp.p[1] = p[1];
-		mp.p[2] = p[2];
-	}
-	
-	// run analysis on the frame we just captured
+	// transform the points into the desired coordinate frame and run analysis on the frame we just captured
 	
-	analyzeFrame(motionFrame, analysis);
+	analyzeMotionFrame(motionFrame, transform, analysis);
 	
 	//
 	
@@ -568,72 +2189,38 @@ void VfxNodeCCL::tick(const float dt)
 		
 		for (int i = 0; i < motionFrame.numPoints; ++i)
 		{
-			points[i * 3 + 0] = motionFrame.points[i].p[xIndex];
-			points[i * 3 + 1] = motionFrame.points[i].p[yIndex];
-			points[i * 3 + 2] = motionFrame.points[i].p[2];
+			points[i * 3 + 0] = motionFrame.p[xIndex][i];
+			points[i * 3 + 1] = motionFrame.p[yIndex][i];
+			points[i * 3 + 2] = motionFrame.p[2][i];
 		}
 		
 		currentDancer.constructFromPoints(points, motionFrame.numPoints);
 		currentDancerSlow = currentDancer;
-		fittestDancer = currentDancer;
-		
-		for (int i = 0; i < kNumDancers; ++i)
-		{
-			dancer[i].constructFromPoints(points, motionFrame.numPoints);
-		}
-	}
-	
-	//
-	
-	env.liveData.numPoints = 0;
-	
-	if (motionFrame.numPoints > 0)
-	{
-		env.liveData.min[0] = motionFrame.points[0].p[xIndex];
-		env.liveData.min[1] = motionFrame.points[0].p[yIndex];
-		env.liveData.max[0] = motionFrame.points[0].p[xIndex];
-		env.liveData.max[1] = motionFrame.points[0].p[yIndex];
+		population.fittestDancer = currentDancer;
 		
-		for (int i = 0; i < motionFrame.numPoints; ++i)
+		for (auto & d : population.dancers)
 		{
-			const double x = motionFrame.points[i].p[xIndex];
-			const double y = motionFrame.points[i].p[yIndex];
-			
-			if (isnan(x) || isnan(y))
-				continue;
-			
-			env.liveData.x[env.liveData.numPoints] = x;
-			env.liveData.y[env.liveData.numPoints] = y;
-			
-			env.liveData.numPoints++;
-			
-			env.liveData.min[0] = std::min(env.liveData.min[0], x);
-			env.liveData.min[1] = std::min(env.liveData.min[1], y);
-			env.liveData.max[0] = std::max(env.liveData.max[0], x);
-			env.liveData.max[1] = std::max(env.liveData.max[1], y);
+			d.constructFromDancer(currentDancer);
 		}
-		
-		env.collisionY = env.liveData.max[1];
 	}
 	
 	//
 	
-	timeToNextFitnessFunction -= dt;
-	
-	if (timeToNextFitnessFunction <= 0.0)
-	{
-		timeToNextFitnessFunction = 10.0;
-		
-		currentFitnessFunction = (FitnessFunction)(rand() % kFitnessFunction_COUNT);
-	}
+	population.updateFitnessFunction(dt);
 	
-	currentDancer.blendTo(fittestDancer, blendToThisFrame);
+	currentDancer.blendTo(population.fittestDancer, blendToThisFrame);
 	
 	currentDancer.tick(dt, fitnessFunction);
 	
 	const double slowBlendPerSec = 0.5;
 	const double slowBlendThisStep = 1.0 - std::pow(1.0 - slowBlendPerSec, dt);
 	
+	// note : the current dancer takes on the topology of the fittest dancer when they differ. start the slow
+	//        dancer over when that happens, as its joints no longer match
+	
+	if (!currentDancerSlow.hasSameTopology(currentDancer))
+		currentDancerSlow = currentDancer;
+	
 	for (int i = 0; i < currentDancer.numJoints; ++i)
 	{
 		const DancerJoint & jSrc = currentDancer.joints[i];
@@ -643,23 +2230,18 @@ void VfxNodeCCL::tick(const float dt)
 		jDst.y = Mix(jDst.y, jSrc.y, slowBlendThisStep);
 	}
 	
-	for (int s = 0; s < 20; ++s)
+	// note : the population size is left alone when the input isn't set, so a population loaded from a checkpoint keeps its size
+	
+	const int populationSize = getInputInt(kInput_PopulationSize, 0);
+	const int generationSteps = std::max(0, getInputInt(kInput_GenerationSteps, kDefaultGenerationSteps));
+	
+	if (populationSize > 0 && populationSize != (int)population.dancers.size())
 	{
-		timeToNextGeneration -= dt;
-		
-		if (timeToNextGeneration <= 0.0)
-		{
-			timeToNextGeneration = 5.0;
-			
-			calculateNextGeneration();
-		}
-		
-		for (int i = 0; i < kNumDancers; ++i)
-		{
-			dancer[i].tick(dt, fitnessFunction);
-		}
+		population.resize(std::max(2, std::min(populationSize, CclPopulation::kMaxSize)));
 	}
 	
+	population.tick(dt, generationSteps);
+	
 	//
 	
 	outputImage->texture = surface->getTexture();
@@ -674,7 +2256,7 @@ void VfxNodeCCL::draw() const
 	const int fixedJoint = getInputInt(kInput_FixedJoint, -1);
 	const bool showVirtualDancers = getInputBool(kInput_ShowGeneticDancers, false);
     //const int fitnessFunction = getInputInt(kInput_FitnessFunction, 0);
-	const FitnessFunction fitnessFunction = currentFitnessFunction;
+	const FitnessFunction fitnessFunction = population.fitnessFunction;
 	const bool showMotionData = getInputBool(kInput_ShowMotionData, false);
 	
 	env.debugDraw = showJointNames;
@@ -688,16 +2270,20 @@ void VfxNodeCCL::draw() const
 		setColor(127, 127, 127);
 		//drawUiRectCheckered(0, 0, GFX_SX, GFX_SY, 32.f);
 		
+		if (providerLoader.isBusy())
+		{
+			setFont("calibri.ttf");
+			drawText(10, 10, 18, +1, +1, "loading %s: %d%%", providerLoader.filename.c_str(), providerLoader.getProgress() / 10);
+		}
+		
 		if (showVirtualDancers)
 		{
 			gxPushMatrix();
 			{
 				double totalSx = 0.0;
 				
-				for (int i = 0; i < kNumDancers; ++i)
+				for (auto & d : population.dancers)
 				{
-					const Dancer & d = dancer[i];
-					
 					const double sx = d.max[0] - d.min[0];
 					totalSx += sx;
 				}
@@ -708,10 +2294,8 @@ void VfxNodeCCL::draw() const
 				
 				double x = 0.0;
 				
-				for (int i = 0; i < kNumDancers; ++i)
+				for (auto & d : population.dancers)
 				{
-					const Dancer & d = dancer[i];
-					
 					const double sx = d.max[0] - d.min[0];
 					
 					gxPushMatrix();
@@ -743,19 +2327,16 @@ void VfxNodeCCL::draw() const
 			{
 				if (fixedJoint >= 0 && fixedJoint < motionFrame.numPoints)
 				{
-					const MotionPoint & mp = motionFrame.points[fixedJoint];
-					gxTranslatef(-mp.p[xIndex], -mp.p[yIndex], 0.f);
+					gxTranslatef(-motionFrame.p[xIndex][fixedJoint], -motionFrame.p[yIndex][fixedJoint], 0.f);
 				}
 				
 				hqBegin(HQ_FILLED_CIRCLES);
 				{
 					for (int i = 0; i < motionFrame.numPoints; ++i)
 					{
-						const MotionPoint & mp = motionFrame.points[i];
-						
 						//setColor(colorWhite);
-						setColorf(mp.v[0] * vColorScale + .5f, mp.v[1] * vColorScale + .5f, mp.v[2] * vColorScale + .5f);
-						hqFillCircle(mp.p[xIndex], mp.p[yIndex], 5.f);
+						setColorf(motionFrame.v[0][i] * vColorScale + .5f, motionFrame.v[1][i] * vColorScale + .5f, motionFrame.v[2][i] * vColorScale + .5f);
+						hqFillCircle(motionFrame.p[xIndex][i], motionFrame.p[yIndex][i], 5.f);
 					}
 				}
 				hqEnd();
@@ -766,20 +2347,20 @@ void VfxNodeCCL::draw() const
 					setColor(colorBlue);
 					for (int i = 0; i < motionFrame.numPoints; ++i)
 					{
-						const MotionPoint & mp = motionFrame.points[i];
+						const std::string * name = motionFrame.names[i];
 						
-						if (mp.name)
+						if (name)
 						{
-							drawText(mp.p[xIndex], mp.p[yIndex], 12, 0, 0, "%s", mp.name->c_str());
+							drawText(motionFrame.p[xIndex][i], motionFrame.p[yIndex][i], 12, 0, 0, "%s", name->c_str());
 						}
 					}
 					
 					if (fixedJoint >= 0 && fixedJoint < motionFrame.numPoints)
 					{
-						const MotionPoint & mp = motionFrame.points[fixedJoint];
+						const std::string * name = motionFrame.names[fixedJoint];
 						
-						if (mp.name)
-							drawText(20, 20, 24, 0, 0, "%s", mp.name->c_str());
+						if (name)
+							drawText(20, 20, 24, 0, 0, "%s", name->c_str());
 					}
 				}
 			}
@@ -849,239 +2430,29 @@ void VfxNodeCCL::draw() const
 	outputImage->texture = surface->getTexture();
 }
 
-void VfxNodeCCL::analyzeFrame(MotionFrame & frame, MotionFrameAnalysis & analysis)
-{
-	// todo : calculate metrics related to posture, movement speed, and whatnot
-	
-	analysis = MotionFrameAnalysis();
-	
-	if (frame.numPoints > 0)
-	{
-		// calculate bounding box
-		
-		float min[3];
-		float max[3];
-		
-		for (int i = 0; i < 3; ++i)
-		{
-			min[i] = frame.points[0].p[i];
-			max[i] = frame.points[0].p[i];
-		}
-		
-		for (int i = 1; i < frame.numPoints; ++i)
-		{
-			for (int j = 0; j < 3; ++j)
-			{
-				min[j] = std::min(min[j], frame.points[i].p[j]);
-				max[j] = std::max(max[j], frame.points[i].p[j]);
-			}
-		}
-		
-		const float kWidenessBegin = 100.f;
-		const float kWidenessEnd = 200.f;
-		const float kNarrownessBegin = 100.f;
-		const float kNarrownessEnd = 50.f;
-		const float kTallnessBegin = 300.f;
-		const float kTallnessEnd = 360.f;
-		const float kSmallnessBegin = 300.f;
-		const float kSmallnessEnd = 200.f;
-		
-		for (int i = 0; i < 3; ++i)
-		{
-			analysis.min[i] = min[i];
-			analysis.max[i] = max[i];
-			
-			analysis.size[i] = max[i] - min[i];
-			analysis.sizeRcp[i] = 1.f / (max[i] - min[i] + eps);
-			
-			analysis.xOverY = analysis.size[xIndex] / (analysis.size[yIndex] + eps);
-			
-			analysis.wideness = std::max(0.f, std::min(1.f, (analysis.size[xIndex] - kWidenessBegin) / (kWidenessEnd - kWidenessBegin)));
-			analysis.narrowness = std::max(0.f, std::min(1.f, (analysis.size[xIndex] - kNarrownessBegin) / (kNarrownessEnd - kNarrownessBegin)));
-			
-			analysis.tallness = std::max(0.f, std::min(1.f, (analysis.size[yIndex] - kTallnessBegin) / (kTallnessEnd - kTallnessBegin)));
-			analysis.smallness = std::max(0.f, std::min(1.f, (analysis.size[yIndex] - kSmallnessBegin) / (kSmallnessEnd - kSmallnessBegin)));
-		}
-	}
-}
-
-void VfxNodeCCL::calculateNextGeneration()
-{
-	const int kBreedingPoolSize = 1000;
-	Dancer * breedingPool[kBreedingPoolSize];
-	
-	Dancer * bestDancer = &dancer[0];
-	
-	for (int i = 1; i < kNumDancers; ++i)
-	{
-		Dancer & d = dancer[i];
-		
-		if (d.totalFitnessValue > bestDancer->totalFitnessValue)
-			bestDancer = &d;
-	}
-		
-	double totalFitness = 0.0;
-	
-	for (int i = 0; i < kNumDancers; ++i)
-	{
-		Dancer & d = dancer[i];
-		
-		totalFitness += d.totalFitnessValue;
-	}
-	
-	if (totalFitness == 0)
-	{
-		logDebug("total fitness value is zero. no sense in breeding!");
-		return;
-	}
-	
-	double currentTotal = 0.0;
-	
-	int index1 = 0;
-	
-	for (int i = 0; i < kNumDancers; ++i)
-	{
-		Dancer & d = dancer[i];
-		
-		currentTotal += d.totalFitnessValue;
-		
-		const int index2 = std::min(int(currentTotal / totalFitness * kBreedingPoolSize), kBreedingPoolSize);
-		
-		//logDebug("filling %d - %d", index1, index2);
-		
-		for (int index = index1; index < index2; ++index)
-		{
-			breedingPool[index] = &d;
-		}
-		
-		index1 = index2;
-	}
-	
-	Assert(index1 == kBreedingPoolSize);
-	
-	if (breedingPool[0] == breedingPool[kBreedingPoolSize - 1])
-	{
-		logDebug("only one unique element in breeding pool. cannot self-breed so skipping breeding phase!");
-		return;
-	}
-	
-	//
-	
-	//logDebug("breeding!");
-	
-	Dancer nextGeneration[kNumDancers];
-	int nextIndex = 0;
-	
-	while (nextIndex < kNumDancers)
-	{
-		const int index1 = rand() % kBreedingPoolSize;
-		const int index2 = rand() % kBreedingPoolSize;
-		
-		const Dancer * d1 = breedingPool[index1];
-		const Dancer * d2 = breedingPool[index2];
-		
-		if (d1 == d2)
-			continue;
-		else
-		{
-			Dancer & n = nextGeneration[nextIndex];
-			
-			n = breed(*bestDancer, *d1, *d2);
-			
-			mutate(n);
-			
-			nextIndex++;
-		}
-	}
-	
-	fittestDancer = *bestDancer;
-	
-	for (int i = 0; i < kNumDancers; ++i)
-	{
-		dancer[i] = nextGeneration[i];
-	}
-}
-
-Dancer VfxNodeCCL::breed(const Dancer & o, const Dancer & d1, const Dancer & d2)
-{
-	Dancer d = o;
-	
-	d.totalFitnessValue = 0.0;
-	
-#if 1
-	for (int i = 0; i < o.numSprings; ++i)
-	{
-		DancerSpring & s = d.springs[i];
-		const DancerSpring & s1 = d1.springs[i];
-		const DancerSpring & s2 = d2.springs[i];
-		
-		s.spasmFrequency = Calc::Lerp(s1.spasmFrequency, s2.spasmFrequency, random(0.0, 1.0));
-		s.springFactor = Calc::Lerp(s1.springFactor, s2.springFactor, random(0.0, 1.0));
-	}
-#endif
-	
-	return d;
-}
-
-void VfxNodeCCL::mutate(Dancer & d)
-{
-	for (int i = 0; i < d.numSprings; ++i)
-	{
-		DancerSpring & s = d.springs[i];
-		
-		s.spasmFrequency += random(-0.1, +0.1);
-		s.springFactor += random(-5.0, +5.0);
-		
-		s.spasmFrequency = std::max(0.0, s.spasmFrequency);
-		s.springFactor = std::max(0.0, s.springFactor);
-		
-		//s.desiredDistance += random(-1.0, +1.0) * 10.0;
-		s.desiredDistance += random(-1.0, +1.0) * 50.0;
-		s.desiredDistance = std::max(s.desiredDistance, 0.0);
-		s.desiredDistance = std::min(s.desiredDistance, s.maximumDistance);
-	}
-}
-
 void VfxNodeCCL::handleTrigger(int socketIndex)
 {
 	if (socketIndex == kInput_OscTrigger)
 	{
-		const std::string values = getInputString(kInput_OscValues, "");
+		const VfxFloatArray * values = getInputFloatArray(kInput_OscValues, nullptr);
 		const float oscScale = getInputFloat(kInput_OscScale, 1.f);
 		
-		std::vector<std::string> splitValues;
-		
-		splitString(values, splitValues, ',');
-		
-		std::vector<float> floatValues;
-		
-		for (std::string & value : splitValues)
-		{
-			if (value.empty())
-				continue;
-			
-			const float floatValue = Parse::Float(value);
-			
-			floatValues.push_back(floatValue);
-		}
-		
-		//logDebug("received %d values!", floatValues.size());
-		
-		//
-		
 		oscFrame = MotionFrame();
 		
-		int index = 0;
-		
-		for (int i = 0; i + 3 <= floatValues.size() && index < MotionFrame::kNumPoints; i += 3, ++index)
+		if (values != nullptr)
 		{
-			MotionPoint & mp = oscFrame.points[index];
-			
-			mp.p[0] = floatValues[i + 0] * oscScale;
-			mp.p[1] = floatValues[i + 1] * oscScale;
-			mp.p[2] = floatValues[i + 2] * oscScale;
+			int index = 0;
 			
-			oscFrame.numPoints++;
+			for (int i = 0; i + 3 <= values->size() && index < MotionFrame::kNumPoints; i += 3, ++index)
+			{
+				oscFrame.p[0][index] = values->elements[i + 0] * oscScale;
+				oscFrame.p[1][index] = values->elements[i + 1] * oscScale;
+				oscFrame.p[2][index] = values->elements[i + 2] * oscScale;
+				
+				oscFrame.numPoints++;
+			}
 		}
+		
+		recorder.record(oscFrame);
 	}
 }
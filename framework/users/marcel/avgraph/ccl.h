@@ -7,35 +7,33 @@
 
 #include "vfxNodes/vfxNodeBase.h"
 #include "cclDancer.h"
+#include "mappedFile.h"
+#include "vfxMessageRing.h"
 
 class Surface;
 
 struct CclKinect;
-
-struct MotionPoint
-{
-	const std::string * name;
-	
-	float p[3];
-	float v[3];
-	
-	MotionPoint()
-	{
-		memset(this, 0, sizeof(*this));
-	}
-};
+struct VfxScheduler;
 
 struct MotionFrame
 {
 	static const int kNumPoints = 100;
-
-	MotionPoint points[kNumPoints];
+	
+	static_assert((kNumPoints % 4) == 0, "the number of points must be a multiple of four, so frames can be processed four points at a time");
+	
+	// positions and velocities are stored per coordinate, so passes over the frame can process four points at
+	// a time. names point into the motion bank the frame was provided by, and are null for live input
+	
+	float p[3][kNumPoints];
+	float v[3][kNumPoints];
+	
+	const std::string * names[kNumPoints];
+	
 	int numPoints;
 	
 	MotionFrame()
-		: points()
-		, numPoints(0)
 	{
+		memset(this, 0, sizeof(*this));
 	}
 };
 
@@ -64,21 +62,6 @@ struct MotionFrameAnalysis
 	}
 };
 
-/*
-struct MotionData
-{
-	static const int kMaxFrames = 1024;
-
-	MotionFrame frames[kMaxFrames];
-	int nextWriteIndex;
-
-	MotionData()
-	{
-		memset(frames, 0, sizeof(frames));
-	}
-};
-*/
-
 //
 
 struct MotionBankKey
@@ -101,53 +84,291 @@ struct MotionBankKey
 
 struct MotionBankChannel
 {
-	std::vector<MotionBankKey> keys;
+	// the keys point either into ownedKeys, for imported motion banks, or into the memory mapped cache file
+	
+	const MotionBankKey * keys;
+	int numKeys;
+	
+	std::vector<MotionBankKey> ownedKeys;
+	
+	float sampleRate; // the number of keys per second, if the keys are sampled uniformly. zero otherwise
+	
 	int nextReadIndex;
 	
 	MotionBankChannel();
 	
+	void useOwnedKeys();
+	
 	void seek(const float time);
 	float interp(const float time);
 };
 
+struct MotionBankSample
+{
+	float p[3];
+};
+
 struct MotionBankJoint
 {
+	// joints with uniformly sampled channels store their positions interleaved, so a lookup is a direct index
+	// computation which touches a single pair of samples. samples point either into ownedSamples or into the
+	// memory mapped cache file. other joints use the channels below
+	
+	const MotionBankSample * samples;
+	int numSamples;
+	float sampleRate;
+	
+	std::vector<MotionBankSample> ownedSamples;
+	
 	MotionBankChannel px;
 	MotionBankChannel py;
 	MotionBankChannel pz;
 	
 	MotionBankJoint()
-		: px()
+		: samples(nullptr)
+		, numSamples(0)
+		, sampleRate(0.f)
+		, ownedSamples()
+		, px()
 		, py()
 		, pz()
 	{
 	}
+	
+	void finalizeImport();
+	
+	void sampleUniform(const float time, float * p, float * v) const;
 };
 
 struct MotionBankProvider
 {
 	std::map<std::string, MotionBankJoint> joints;
 	
+	MappedFile cacheFile;
+	
 	MotionBankProvider()
 		: joints()
+		, cacheFile()
 	{
 	}
 	
-	bool load(const char * filename);
-	bool save(const char * filename) const;
-	bool import(const char * filename);
+	// loads a cache file written by save. the cache is rejected when it's invalid, or when it was built from a
+	// different version of the source file. sourceFilename may be null to skip the latter check
+	
+	bool load(const char * filename, const char * sourceFilename);
+	bool save(const char * filename, const char * sourceFilename) const;
+	
+	// imports a motion bank recording. the json file is parsed as a stream, without building a document for
+	// it. progress receives the fraction of the file parsed so far, in 1/1000ths. setting cancel stops the import
+	
+	bool import(const char * filename, SDL_atomic_t * progress = nullptr, SDL_atomic_t * cancel = nullptr);
 	
 	bool provide(const float time, MotionFrame & frame);
 };
 
+// loads a motion bank on a background thread, importing it and rebuilding the cache when necessary
+
+struct MotionBankLoader
+{
+	std::string filename;
+	
+	MotionBankProvider * provider;
+	
+	SDL_Thread * thread;
+	
+	SDL_atomic_t isDone;
+	SDL_atomic_t progress;
+	SDL_atomic_t cancelRequested;
+	
+	MotionBankLoader();
+	~MotionBankLoader();
+	
+	void begin(const char * filename);
+	void cancel();
+	
+	bool isBusy() const
+	{
+		return thread != nullptr;
+	}
+	
+	bool isFinished();
+	int getProgress() const;
+	
+	// waits for the loader to finish, and hands over the loaded motion bank. the motion bank is empty when
+	// loading failed
+	
+	MotionBankProvider * end();
+	
+	static int threadMain(void * data);
+};
+
+/*
+
+MotionBankRecorder captures live motion frames into a motion bank cache, which can be replayed the same way
+as an imported motion bank. record is called on the input thread. it stamps the frame with the time since
+recording began and copies it into a preallocated ring, without allocating memory or taking locks. a writer
+thread drains the ring, resamples the frames to a fixed rate and appends them to the joints, so the recording
+uses the uniformly sampled fast path on replay. the cache is written by the writer thread when recording ends.
+
+the samples are kept in memory until then, which is 12 bytes per joint per sample, or about 65MB per hour
+for 25 joints at 60Hz.
+
+usage:
+	
+	recorder.begin("rehearsal.json.cache");
+	
+	// input thread
+	
+	recorder.record(frame);
+	
+	// stop recording. the cache is written in the background
+	
+	recorder.end();
+
+*/
+
+struct MotionBankRecorder
+{
+	static const int kRingCapacity = 1024;
+	static const int kDefaultSampleRate = 60;
+	
+	struct Frame
+	{
+		double time;
+		int numPoints;
+		float p[3][MotionFrame::kNumPoints];
+	};
+	
+	std::string filename;
+	float sampleRate;
+	
+	VfxMessageRing<Frame, kRingCapacity> * ring;
+	
+	SDL_Thread * thread;
+	
+	SDL_atomic_t recording;
+	SDL_atomic_t stopRequested;
+	
+	uint64_t startTime;
+	
+	MotionBankRecorder();
+	~MotionBankRecorder();
+	
+	bool begin(const char * filename, const float sampleRate = kDefaultSampleRate);
+	void end();
+	
+	// waits for the writer thread to finish writing the previous recording
+	
+	void wait();
+	
+	bool isRecording() const
+	{
+		return SDL_AtomicGet(const_cast<SDL_atomic_t*>(&recording)) != 0;
+	}
+	
+	void record(const MotionFrame & frame);
+	
+	static int threadMain(void * data);
+};
+
 //
 
 bool provideMotionData_MotionBank(const float time, MotionBankProvider & provider, MotionFrame & frame);
 bool provideMotionData_Kinect(const float time, MotionFrame & frame);
 
+//
+
+struct CclPopulation
+{
+	static const int kDefaultSize = 8;
+	static const int kMaxSize = 1024;
+	
+	std::vector<Dancer> dancers;
+	std::vector<Dancer> nextGeneration;
+	Dancer fittestDancer;
+	
+	double timeToNextGeneration;
+	double timeToNextFitnessFunction;
+	FitnessFunction fitnessFunction;
+	
+	int generation;
+	
+	DancerRandom rng;
+	
+	VfxScheduler * scheduler; // when set, the dancers are ticked and bred in parallel
+	
+	CclPopulation();
+	
+	void init(const int size, const uint64_t seed);
+	void resize(const int size);
+	
+	void updateFitnessFunction(const double dt);
+	void tick(const float dt, const int numSteps);
+	void tickDancers(const float dt, const int numSteps);
+	
+	bool calculateNextGeneration();
+	static void breed(Dancer & d, const Dancer & o, const Dancer & d1, const Dancer & d2, const uint64_t seed);
+	static void mutate(Dancer & d);
+	
+	bool saveCheckpoint(const char * filename) const;
+	bool loadCheckpoint(const char * filename);
+};
+
+// settings for evolving a population ahead of time, by replaying a motion bank at maximum speed without
+// a window or any graphics state. the defaults match the defaults of the ccl node
+
+struct CclEvolveSettings
+{
+	std::string motionBankFilename;
+	std::string checkpointFilename;
+	
+	double duration;
+	double checkpointInterval;
+	float dt;
+	float replaySpeed;
+	
+	int populationSize;
+	int generationSteps;
+	uint64_t seed;
+	
+	int bodyConnectivity;
+	float bodyDistance;
+	float envGravity;
+	float envFactorX;
+	float envFactorY;
+	bool envUseSpasms;
+	bool envUseSprings;
+	bool envUseDistanceConstraint;
+	
+	CclEvolveSettings()
+		: motionBankFilename()
+		, checkpointFilename()
+		, duration(600.0)
+		, checkpointInterval(60.0)
+		, dt(1.f / 60.f)
+		, replaySpeed(1.f)
+		, populationSize(CclPopulation::kDefaultSize)
+		, generationSteps(20)
+		, seed(0)
+		, bodyConnectivity(4)
+		, bodyDistance(1.f)
+		, envGravity(0.f)
+		, envFactorX(0.f)
+		, envFactorY(0.f)
+		, envUseSpasms(false)
+		, envUseSprings(false)
+		, envUseDistanceConstraint(false)
+	{
+	}
+	
+	bool parse(const char * keyValue);
+};
+
+bool evolvePopulation_MotionBank(const CclEvolveSettings & settings);
+
 struct VfxNodeCCL : VfxNodeBase
 {
-	const static int kNumDancers = 8;
+	const static int kDefaultGenerationSteps = 20;
 	
 	enum Imnput
 	{
@@ -174,6 +395,11 @@ struct VfxNodeCCL : VfxNodeBase
 		kInput_EnvUseSprings,
 		kInput_EnvUseDistanceConstraint,
 		kInput_ShowMotionData,
+		kInput_PopulationSize,
+		kInput_GenerationSteps,
+		kInput_Checkpoint,
+		kInput_Record,
+		kInput_RecordFilename,
 		kInput_COUNT
 	};
 	
@@ -183,7 +409,10 @@ struct VfxNodeCCL : VfxNodeBase
 		kOutput_COUNT
 	};
 	
-	MotionBankProvider provider;
+	MotionBankProvider * provider;
+	MotionBankLoader providerLoader;
+	
+	MotionBankRecorder recorder;
 	
 	Surface * surface;
 	
@@ -195,15 +424,12 @@ struct VfxNodeCCL : VfxNodeBase
 	
 	Dancer currentDancer;
 	Dancer currentDancerSlow;
-	Dancer fittestDancer;
-	Dancer dancer[kNumDancers];
-	double timeToNextGeneration;
-	double timeToNextFitnessFunction;
-	FitnessFunction currentFitnessFunction;
+	CclPopulation population;
 	
 	//
 	
 	std::string filename;
+	std::string checkpointFilename;
 	
 	float time;
 	MotionFrame motionFrame;
@@ -215,11 +441,5 @@ struct VfxNodeCCL : VfxNodeBase
 	virtual void tick(const float dt) override;
 	virtual void draw() const override;
 	
-	void analyzeFrame(MotionFrame & frame, MotionFrameAnalysis & analysis);
-	
-	void calculateNextGeneration();
-	Dancer breed(const Dancer & o, const Dancer & d1, const Dancer & d2);
-	void mutate(Dancer & d);
-	
 	virtual void handleTrigger(int socketIndex) override;
 };
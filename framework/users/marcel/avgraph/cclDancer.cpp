@@ -1,6 +1,13 @@
 #include "cclDancer.h"
 #include "framework.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define DANCER_USE_SSE 1
+	#include <emmintrin.h>
+#else
+	#define DANCER_USE_SSE 0
+#endif
+
 static const double eps = 0.00001;
 
 DancerEnv env;
@@ -31,8 +38,40 @@ const char * getFitnessFunctionName(FitnessFunction f)
 //
 
 Dancer::Dancer()
+	: numJoints(0)
+	, numSprings(0)
+	, numSpringSlots(0)
+	, dampeningPerSecond(0.0)
+	, accelTowardsOtherDancer(0.0)
+	, min()
+	, max()
+	, totalFitnessValue(0.0)
+	, rng()
+	, joints()
+	, springs()
+	, springSlots()
+{
+}
+
+void Dancer::reset()
 {
-	memset(this, 0, sizeof(*this));
+	// note : the random number generator and the storage of the joints and springs are left alone
+	
+	numJoints = 0;
+	numSprings = 0;
+	numSpringSlots = 0;
+	
+	dampeningPerSecond = 0.0;
+	accelTowardsOtherDancer = 0.0;
+	
+	min[0] = min[1] = 0.0;
+	max[0] = max[1] = 0.0;
+	
+	totalFitnessValue = 0.0;
+	
+	joints.clear();
+	springs.clear();
+	springSlots.clear();
 }
 
 void Dancer::calculateMinMax(double * min, double * max) const
@@ -149,25 +188,28 @@ double Dancer::calculateFitness(const FitnessFunction fitnessFunction) const
 void Dancer::randomize()
 {
 #if 1
-	const int numPoints = (rand() % (kMaxJoints - 3)) + 3;
+	const int numPoints = rng.nextInt(kMaxJoints - 3) + 3;
 	
 	float points[numPoints * 3];
 	
 	for (int i = 0; i < numPoints; ++i)
 	{
-		points[i * 3 + 0] = random(-100.0, +100.0);
-		points[i * 3 + 1] = random(-200.0, +200.0);
+		points[i * 3 + 0] = rng.nextDouble(-100.0, +100.0);
+		points[i * 3 + 1] = rng.nextDouble(-200.0, +200.0);
 		points[i * 3 + 2] = 0.0;
 	}
 	
 	constructFromPoints(points, numPoints);
 #else
-	memset(this, 0, sizeof(*this));
+	reset();
 	
-	numJoints = (rand() % (kMaxJoints - 3)) + 3;
+	numJoints = rng.nextInt(kMaxJoints - 3) + 3;
+	joints.resize(numJoints, DancerJoint());
 	
 	dampeningPerSecond = 0.8;
 	
+	springs.resize(numJoints * (numJoints - 1) / 2, DancerSpring());
+	
 	for (int i = 0; i < numJoints; ++i)
 	{
 		for (int j = i + 1; j < numJoints; ++j)
@@ -183,8 +225,8 @@ void Dancer::randomize()
 	{
 		DancerJoint & j = joints[i];
 		
-		j.x = random(-100.0, +100.0);
-		j.y = random(-200.0, +200.0);
+		j.x = rng.nextDouble(-100.0, +100.0);
+		j.y = rng.nextDouble(-200.0, +200.0);
 	}
 	
 	randomizeSpringFactors();
@@ -199,9 +241,9 @@ void Dancer::randomizeSpringFactors()
 	{
 		DancerSpring & s = springs[i];
 		
-		s.spasmFrequency = random(0.05, 0.1) * 2.0 * M_PI;
-		s.spasmPhase = random(0.0, 1.0) * 2.0 * M_PI;
-		s.springFactor = random(0.0, 200.0);
+		s.spasmFrequency = rng.nextDouble(0.05, 0.1) * 2.0 * M_PI;
+		s.spasmPhase = rng.nextDouble(0.0, 1.0) * 2.0 * M_PI;
+		s.springFactor = rng.nextDouble(0.0, 200.0);
 		//s.springFactor = random(100.0, 10000.0);
 		//s.springFactor = random(100000.0, 100000.0);
 	}
@@ -209,13 +251,178 @@ void Dancer::randomizeSpringFactors()
 	accelTowardsOtherDancer = 100.0;
 }
 
+// uniform grid over the joints of a dancer, used to find the nearest joints of each joint without comparing
+// every pair of joints. the cell size is chosen such that there's about one joint per cell. a query searches
+// rings of cells around the cell of the joint, until no cell further out can hold a joint nearer than the
+// nearest joints found so far
+
+struct DancerJointGrid
+{
+	static const int kMaxCells = kMaxJoints * 4;
+	
+	struct Neighbour
+	{
+		double distanceSq;
+		int index;
+		
+		bool operator<(const Neighbour & other) const
+		{
+			if (distanceSq != other.distanceSq)
+				return distanceSq < other.distanceSq;
+			return index < other.index;
+		}
+	};
+	
+	const DancerJoint * joints;
+	
+	double minX;
+	double minY;
+	double cellSize;
+	
+	int sx;
+	int sy;
+	
+	short cellBegin[kMaxCells + 1];
+	short jointIndices[kMaxJoints];
+	
+	int getCellX(const double x) const
+	{
+		return std::max(0, std::min(sx - 1, int((x - minX) / cellSize)));
+	}
+	
+	int getCellY(const double y) const
+	{
+		return std::max(0, std::min(sy - 1, int((y - minY) / cellSize)));
+	}
+	
+	void build(const DancerJoint * _joints, const int numJoints, const double * min, const double * max)
+	{
+		joints = _joints;
+		
+		minX = min[0];
+		minY = min[1];
+		
+		const double extentX = max[0] - min[0];
+		const double extentY = max[1] - min[1];
+		
+		// note : the second term keeps the number of cells in check when the joints lie (almost) on a line
+		
+		cellSize = std::max(std::sqrt(extentX * extentY / std::max(1, numJoints)), std::max(extentX, extentY) / std::max(1, numJoints));
+		
+		if (!(cellSize > 0.0))
+			cellSize = 1.0;
+		
+		sx = int(extentX / cellSize) + 1;
+		sy = int(extentY / cellSize) + 1;
+		
+		Assert(sx * sy <= kMaxCells);
+		
+		// sort the joints by cell
+		
+		memset(cellBegin, 0, sizeof(cellBegin));
+		
+		for (int i = 0; i < numJoints; ++i)
+			cellBegin[getCellY(joints[i].y) * sx + getCellX(joints[i].x) + 1]++;
+		
+		for (int i = 0; i < sx * sy; ++i)
+			cellBegin[i + 1] += cellBegin[i];
+		
+		short cellEnd[kMaxCells];
+		memcpy(cellEnd, cellBegin, sizeof(cellEnd));
+		
+		for (int i = 0; i < numJoints; ++i)
+			jointIndices[cellEnd[getCellY(joints[i].y) * sx + getCellX(joints[i].x)]++] = i;
+	}
+	
+	// finds the maxCount nearest joints to the given joint, skipping the joints set in the excluded bitmap.
+	// the neighbours are sorted by distance
+	
+	int findNearest(const int index, const uint64_t * excluded, const int maxCount, Neighbour * neighbours) const
+	{
+		if (maxCount <= 0)
+			return 0;
+		
+		const DancerJoint & joint = joints[index];
+		
+		const int cx = getCellX(joint.x);
+		const int cy = getCellY(joint.y);
+		
+		int count = 0;
+		
+		for (int r = 0; r <= std::max(sx, sy); ++r)
+		{
+			for (int y = cy - r; y <= cy + r; ++y)
+			{
+				if (y < 0 || y >= sy)
+					continue;
+				
+				// the top and bottom rows of the ring span all columns, the other rows just the two at the sides
+				
+				const bool isFullRow = (y == cy - r || y == cy + r);
+				const int xStep = isFullRow ? 1 : std::max(1, r * 2);
+				
+				for (int x = cx - r; x <= cx + r; x += xStep)
+				{
+					if (x < 0 || x >= sx)
+						continue;
+					
+					const int cellIndex = y * sx + x;
+					
+					for (int i = cellBegin[cellIndex]; i < cellBegin[cellIndex + 1]; ++i)
+					{
+						const int otherIndex = jointIndices[i];
+						
+						if (otherIndex == index || (excluded[otherIndex / 64] & (uint64_t(1) << (otherIndex % 64))))
+							continue;
+						
+						const double dx = joints[otherIndex].x - joint.x;
+						const double dy = joints[otherIndex].y - joint.y;
+						
+						Neighbour n;
+						n.distanceSq = dx * dx + dy * dy;
+						n.index = otherIndex;
+						
+						// partial selection. keep the maxCount nearest joints, sorted by insertion
+						
+						if (count == maxCount && !(n < neighbours[count - 1]))
+							continue;
+						
+						int position = count < maxCount ? count++ : count - 1;
+						
+						while (position > 0 && n < neighbours[position - 1])
+						{
+							neighbours[position] = neighbours[position - 1];
+							position--;
+						}
+						
+						neighbours[position] = n;
+					}
+				}
+			}
+			
+			// joints outside the rings searched so far are at least r cells away
+			
+			const double minDistance = r * cellSize;
+			
+			if (count == maxCount && neighbours[count - 1].distanceSq < minDistance * minDistance)
+				break;
+		}
+		
+		return count;
+	}
+};
+
 void Dancer::constructFromPoints(const float * points, const int numPoints)
 {
-	memset(this, 0, sizeof(*this));
+	// note : the random number generator survives reconstruction, so dancers constructed from the same points still diverge
+	
+	reset();
 	
 	dampeningPerSecond = 0.9;
 	
-	for (int i = 0; i < numPoints; ++i)
+	joints.resize(std::min(numPoints, kMaxJoints), DancerJoint());
+	
+	for (int i = 0; i < numPoints && numJoints < kMaxJoints; ++i)
 	{
 		const double x = points[i * 3 + 0];
 		const double y = points[i * 3 + 1];
@@ -237,87 +444,68 @@ void Dancer::constructFromPoints(const float * points, const int numPoints)
 		Assert(!std::isinf(j.y));
 	}
 	
+	joints.resize(numJoints);
+	
 	calculateMinMax(min, max);
 	
-	const double sx = max[0] - min[0];
-	const double sy = max[1] - min[1];
-	const double diagonalSize = std::hypot(sx, sy);
-	const double connectionTreshold = diagonalSize * 0.3;
+	// connect each joint to its nearest joints, skipping the joints it's already connected to
 	
-	struct Connection
-	{
-		int index1;
-		int index2;
-		
-		double distance;
-		
-		bool operator<(const Connection & other) const
-		{
-			if (index1 != other.index1)
-				return index1 < other.index1;
-			return index2 < other.index2;
-		}
-	};
+	DancerJointGrid grid;
+	grid.build(joints.data(), numJoints, min, max);
+	
+	static const int kNumConnectionWords = kMaxJoints / 64;
+	
+	uint64_t connections[kMaxJoints][kNumConnectionWords];
+	memset(connections, 0, sizeof(connections));
 	
-	std::set<Connection> connections;
+	const int maxConnections = std::max(0, std::min(env.numConnectedJoints, kMaxJoints - 1));
+	
+	DancerJointGrid::Neighbour neighbours[kMaxJoints];
+	
+	springs.resize(std::min(numJoints * maxConnections, kMaxSprings), DancerSpring());
 	
 	for (int i = 0; i < numJoints; ++i)
 	{
-		std::vector<Connection> candidates;
-		
-		for (int j = 0; j < numJoints; ++j)
-		{
-			if (i == j)
-				continue;
-			
-			// already connected ?
-			
-			Connection c;
-			c.index1 = i;
-			c.index2 = j;
-			
-			if (connections.count(c) != 0)
-				continue;
-			
-			DancerJoint & j1 = joints[i];
-			DancerJoint & j2 = joints[j];
-			
-			const double dx = j2.x - j1.x;
-			const double dy = j2.y - j1.y;
-			const double ds = std::hypot(dx, dy);
-			
-			c.distance = ds;
-			
-			candidates.push_back(c);
-		}
-		
-		std::sort(candidates.begin(), candidates.end(), [](const Connection & c1, const Connection & c2) { return c1.distance < c2.distance; });
+		const int numNeighbours = grid.findNearest(i, connections[i], maxConnections, neighbours);
 		
 		DancerJoint & jt = joints[i];
 		
-		for (int i = 0; jt.numConnections < env.numConnectedJoints && i < candidates.size(); ++i)
+		for (int n = 0; n < numNeighbours && numSprings < kMaxSprings; ++n)
 		{
-			Connection & c = candidates[i];
+			const int j = neighbours[n].index;
 			
-			if (c.distance < connectionTreshold || true)
-			{
-				jt.numConnections++;
-				
-				connections.insert(c);
+			jt.numConnections++;
 			
-				DancerSpring & s = springs[numSprings++];
-				
-				s.jointIndex1 = c.index1;
-				s.jointIndex2 = c.index2;
-			}
+			connections[i][j / 64] |= uint64_t(1) << (j % 64);
+			connections[j][i / 64] |= uint64_t(1) << (i % 64);
+			
+			DancerSpring & s = springs[numSprings++];
+			
+			s.jointIndex1 = i;
+			s.jointIndex2 = j;
 		}
 	}
 	
+	springs.resize(numSprings);
+	
 	randomizeSpringFactors();
 	
 	finalize();
 }
 
+void Dancer::constructFromDancer(const Dancer & other)
+{
+	// note : everything but the spring factors only depends on the points, so it's copied instead of rebuilt
+	
+	const DancerRandom oldRng = rng;
+	
+	*this = other;
+	
+	rng = oldRng;
+	
+	randomizeSpringFactors();
+}
+
 void Dancer::finalize()
 {
 	for (int i = 0; i < numSprings; ++i)
@@ -334,6 +522,85 @@ void Dancer::finalize()
 		s.desiredDistance = ds;
 		s.maximumDistance = ds * env.maxDistanceFactor;
 	}
+	
+	calculateSpringSlots();
+}
+
+void Dancer::calculateSpringSlots()
+{
+	// group the springs into colors, such that no two springs of the same color share a joint. this lets
+	// the batched solver process the springs of a color in parallel
+	
+	static const int kNumColorWords = kMaxSpringColors / 64;
+	
+	uint64_t jointColors[kMaxJoints][kNumColorWords];
+	memset(jointColors, 0, sizeof(jointColors));
+	
+	short springColors[kMaxSprings];
+	int numSpringsPerColor[kMaxSpringColors];
+	memset(numSpringsPerColor, 0, sizeof(numSpringsPerColor));
+	
+	int numColors = 0;
+	
+	for (int i = 0; i < numSprings; ++i)
+	{
+		const DancerSpring & s = springs[i];
+		
+		const uint64_t * colors1 = jointColors[s.jointIndex1];
+		const uint64_t * colors2 = jointColors[s.jointIndex2];
+		
+		int color = 0;
+		
+		while ((colors1[color / 64] | colors2[color / 64]) & (uint64_t(1) << (color % 64)))
+			color++;
+		
+		Assert(color < kMaxSpringColors);
+		
+		jointColors[s.jointIndex1][color / 64] |= uint64_t(1) << (color % 64);
+		jointColors[s.jointIndex2][color / 64] |= uint64_t(1) << (color % 64);
+		
+		springColors[i] = color;
+		numSpringsPerColor[color]++;
+		
+		numColors = std::max(numColors, color + 1);
+	}
+	
+	// lay out the colors one after the other, each padded to a multiple of the batch size
+	
+	int colorOffsets[kMaxSpringColors];
+	
+	numSpringSlots = 0;
+	
+	for (int c = 0; c < numColors; ++c)
+	{
+		colorOffsets[c] = numSpringSlots;
+		
+		numSpringSlots += (numSpringsPerColor[c] + kSpringBatchSize - 1) / kSpringBatchSize * kSpringBatchSize;
+	}
+	
+	Assert(numSpringSlots <= kMaxSpringSlots);
+	
+	springSlots.assign(numSpringSlots, -1);
+	
+	for (int i = 0; i < numSprings; ++i)
+		springSlots[colorOffsets[springColors[i]]++] = i;
+}
+
+bool Dancer::hasSameTopology(const Dancer & other) const
+{
+	if (numJoints != other.numJoints || numSprings != other.numSprings)
+		return false;
+	
+	for (int i = 0; i < numSprings; ++i)
+	{
+		const DancerSpring & s1 = springs[i];
+		const DancerSpring & s2 = other.springs[i];
+		
+		if (s1.jointIndex1 != s2.jointIndex1 || s1.jointIndex2 != s2.jointIndex2)
+			return false;
+	}
+	
+	return true;
 }
 
 void Dancer::tick(const double dt, const FitnessFunction fitnessFunction)
@@ -354,7 +621,7 @@ void Dancer::tick(const double dt, const FitnessFunction fitnessFunction)
 	
 	if (mouse.wentDown(BUTTON_LEFT))
 	{
-		for (int i = 0; i < numJoints; ++i)
+		for (int i = 0; i < numJoints && i < numSprings; ++i)
 		{
 			//const int index = rand() % numSprings;
 			const int index = i;
@@ -377,6 +644,21 @@ void Dancer::tick(const double dt, const FitnessFunction fitnessFunction)
 		}
 	}
 	
+	if (env.useReferenceSolver)
+		tickReference(dtReal, numSteps, dampeningPerStep);
+	else
+		tickBatched(dtReal, numSteps, dampeningPerStep);
+	
+	calculateMinMax(min, max);
+	
+	totalFitnessValue += calculateFitness(fitnessFunction) * dt;
+}
+
+void Dancer::tickReference(const double dtReal, const int numSteps, const double dampeningPerStep)
+{
+	// scalar, double precision solver. processes the springs in their original order. kept around to
+	// validate the batched solver against
+	
 	for (int i = 0; i < numSteps; ++i)
 	{
     #if 0
@@ -489,10 +771,249 @@ void Dancer::tick(const double dt, const FitnessFunction fitnessFunction)
 			jt.y += jt.vy * dtReal * env.yFactor;
 		}
 	}
+}
+
+void Dancer::tickBatched(const double dtReal, const int numSteps, const double dampeningPerStep)
+{
+	// structure of arrays, single precision solver. the springs are processed in batches of joint-disjoint
+	// springs, so the springs in a batch can be solved at the same time. padding slots refer to a dummy
+	// joint which always stays at the origin, and have no effect on the other joints
 	
-	calculateMinMax(min, max);
+	static const int kDummyJoint = kMaxJoints;
 	
-	totalFitnessValue += calculateFitness(fitnessFunction) * dt;
+	struct alignas(16) State
+	{
+		float x[kMaxJoints + kSpringBatchSize];
+		float y[kMaxJoints + kSpringBatchSize];
+		float vx[kMaxJoints + kSpringBatchSize];
+		float vy[kMaxJoints + kSpringBatchSize];
+		float ax[kMaxJoints + kSpringBatchSize];
+		float ay[kMaxJoints + kSpringBatchSize];
+		
+		int joint1[kMaxSpringSlots];
+		int joint2[kMaxSpringSlots];
+		float desiredDistance[kMaxSpringSlots];
+		float springFactor[kMaxSpringSlots];
+	};
+	
+	State state;
+	
+	const int numJointsPadded = (numJoints + kSpringBatchSize - 1) / kSpringBatchSize * kSpringBatchSize;
+	
+	// note : the padding joints and the dummy joint are included, so they start out at the origin
+	
+	for (int i = 0; i < kMaxJoints + kSpringBatchSize; ++i)
+	{
+		if (i == numJointsPadded && i < kDummyJoint)
+			i = kDummyJoint;
+		
+		const bool isJoint = i < numJoints;
+		
+		state.x[i] = isJoint ? joints[i].x : 0.f;
+		state.y[i] = isJoint ? joints[i].y : 0.f;
+		state.vx[i] = isJoint ? joints[i].vx : 0.f;
+		state.vy[i] = isJoint ? joints[i].vy : 0.f;
+		state.ax[i] = 0.f;
+		state.ay[i] = 0.f;
+	}
+	
+	for (int i = 0; i < numSpringSlots; ++i)
+	{
+		const int index = springSlots[i];
+		
+		if (index >= 0)
+		{
+			const DancerSpring & s = springs[index];
+			
+			state.joint1[i] = s.jointIndex1;
+			state.joint2[i] = s.jointIndex2;
+			state.desiredDistance[i] = s.desiredDistance;
+			state.springFactor[i] = s.springFactor;
+		}
+		else
+		{
+			state.joint1[i] = kDummyJoint;
+			state.joint2[i] = kDummyJoint;
+			state.desiredDistance[i] = 0.f;
+			state.springFactor[i] = 0.f;
+		}
+	}
+	
+	const float dt = dtReal;
+	const float dampening = dampeningPerStep;
+	const float gravityY = env.gravityY;
+	const float collisionY = env.collisionY;
+	const float fitting = 1.f / 2.f / 2.f;
+	const float fittingX = fitting * env.xFactor;
+	const float fittingY = fitting * env.yFactor;
+	const float xFactor = env.xFactor;
+	const float yFactor = env.yFactor;
+	const bool useDistanceConstraint = env.useDistanceConstraint;
+	const bool useSprings = env.useSprings;
+	
+	for (int step = 0; step < numSteps; ++step)
+	{
+	#if DANCER_USE_SSE
+		const __m128 gravityY4 = _mm_set1_ps(gravityY);
+		const __m128 collisionY4 = _mm_set1_ps(collisionY);
+		
+		for (int j = 0; j < numJointsPadded; j += 4)
+		{
+			_mm_store_ps(state.ax + j, _mm_setzero_ps());
+			_mm_store_ps(state.ay + j, gravityY4);
+			_mm_store_ps(state.y + j, _mm_min_ps(_mm_load_ps(state.y + j), collisionY4));
+		}
+		
+		const __m128 eps4 = _mm_set1_ps(eps);
+		const __m128 fittingX4 = _mm_set1_ps(fittingX);
+		const __m128 fittingY4 = _mm_set1_ps(fittingY);
+		
+		for (int b = 0; b < numSpringSlots; b += 4)
+		{
+			const int * j1 = state.joint1 + b;
+			const int * j2 = state.joint2 + b;
+			
+			__m128 x1 = _mm_setr_ps(state.x[j1[0]], state.x[j1[1]], state.x[j1[2]], state.x[j1[3]]);
+			__m128 y1 = _mm_setr_ps(state.y[j1[0]], state.y[j1[1]], state.y[j1[2]], state.y[j1[3]]);
+			__m128 x2 = _mm_setr_ps(state.x[j2[0]], state.x[j2[1]], state.x[j2[2]], state.x[j2[3]]);
+			__m128 y2 = _mm_setr_ps(state.y[j2[0]], state.y[j2[1]], state.y[j2[2]], state.y[j2[3]]);
+			
+			const __m128 dx = _mm_sub_ps(x2, x1);
+			const __m128 dy = _mm_sub_ps(y2, y1);
+			const __m128 ds = _mm_add_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))), eps4);
+			const __m128 nx = _mm_div_ps(dx, ds);
+			const __m128 ny = _mm_div_ps(dy, ds);
+			
+			const __m128 dd = _mm_sub_ps(ds, _mm_load_ps(state.desiredDistance + b));
+			
+			alignas(16) float temp[4];
+			
+			if (useDistanceConstraint)
+			{
+				const __m128 ox = _mm_mul_ps(_mm_mul_ps(dd, nx), fittingX4);
+				const __m128 oy = _mm_mul_ps(_mm_mul_ps(dd, ny), fittingY4);
+				
+				x1 = _mm_add_ps(x1, ox);
+				y1 = _mm_add_ps(y1, oy);
+				x2 = _mm_sub_ps(x2, ox);
+				y2 = _mm_sub_ps(y2, oy);
+				
+				// note : the joints within a batch are unique, so the results can be scattered back one by one
+				
+				_mm_store_ps(temp, x1);
+				for (int k = 0; k < 4; ++k)
+					state.x[j1[k]] = temp[k];
+				
+				_mm_store_ps(temp, y1);
+				for (int k = 0; k < 4; ++k)
+					state.y[j1[k]] = temp[k];
+				
+				_mm_store_ps(temp, x2);
+				for (int k = 0; k < 4; ++k)
+					state.x[j2[k]] = temp[k];
+				
+				_mm_store_ps(temp, y2);
+				for (int k = 0; k < 4; ++k)
+					state.y[j2[k]] = temp[k];
+			}
+			
+			if (useSprings)
+			{
+				const __m128 a = _mm_mul_ps(dd, _mm_load_ps(state.springFactor + b));
+				
+				_mm_store_ps(temp, _mm_mul_ps(nx, a));
+				for (int k = 0; k < 4; ++k)
+				{
+					state.ax[j1[k]] += temp[k];
+					state.ax[j2[k]] -= temp[k];
+				}
+				
+				_mm_store_ps(temp, _mm_mul_ps(ny, a));
+				for (int k = 0; k < 4; ++k)
+				{
+					state.ay[j1[k]] += temp[k];
+					state.ay[j2[k]] -= temp[k];
+				}
+			}
+		}
+		
+		const __m128 dt4 = _mm_set1_ps(dt);
+		const __m128 dampening4 = _mm_set1_ps(dampening);
+		const __m128 moveX4 = _mm_set1_ps(dt * xFactor);
+		const __m128 moveY4 = _mm_set1_ps(dt * yFactor);
+		
+		for (int j = 0; j < numJointsPadded; j += 4)
+		{
+			const __m128 vx = _mm_mul_ps(_mm_add_ps(_mm_load_ps(state.vx + j), _mm_mul_ps(_mm_load_ps(state.ax + j), dt4)), dampening4);
+			const __m128 vy = _mm_mul_ps(_mm_add_ps(_mm_load_ps(state.vy + j), _mm_mul_ps(_mm_load_ps(state.ay + j), dt4)), dampening4);
+			
+			_mm_store_ps(state.vx + j, vx);
+			_mm_store_ps(state.vy + j, vy);
+			_mm_store_ps(state.x + j, _mm_add_ps(_mm_load_ps(state.x + j), _mm_mul_ps(vx, moveX4)));
+			_mm_store_ps(state.y + j, _mm_add_ps(_mm_load_ps(state.y + j), _mm_mul_ps(vy, moveY4)));
+		}
+	#else
+		for (int j = 0; j < numJointsPadded; ++j)
+		{
+			state.ax[j] = 0.f;
+			state.ay[j] = gravityY;
+			state.y[j] = std::min(state.y[j], collisionY);
+		}
+		
+		for (int i = 0; i < numSpringSlots; ++i)
+		{
+			const int j1 = state.joint1[i];
+			const int j2 = state.joint2[i];
+			
+			const float dx = state.x[j2] - state.x[j1];
+			const float dy = state.y[j2] - state.y[j1];
+			const float ds = std::sqrt(dx * dx + dy * dy) + float(eps);
+			const float nx = dx / ds;
+			const float ny = dy / ds;
+			
+			const float dd = ds - state.desiredDistance[i];
+			
+			if (useDistanceConstraint)
+			{
+				state.x[j1] += dd * nx * fittingX;
+				state.y[j1] += dd * ny * fittingY;
+				state.x[j2] -= dd * nx * fittingX;
+				state.y[j2] -= dd * ny * fittingY;
+			}
+			
+			if (useSprings)
+			{
+				const float a = dd * state.springFactor[i];
+				
+				state.ax[j1] += nx * a;
+				state.ay[j1] += ny * a;
+				state.ax[j2] -= nx * a;
+				state.ay[j2] -= ny * a;
+			}
+		}
+		
+		for (int j = 0; j < numJointsPadded; ++j)
+		{
+			state.vx[j] = (state.vx[j] + state.ax[j] * dt) * dampening;
+			state.vy[j] = (state.vy[j] + state.ay[j] * dt) * dampening;
+			
+			state.x[j] += state.vx[j] * dt * xFactor;
+			state.y[j] += state.vy[j] * dt * yFactor;
+		}
+	#endif
+	}
+	
+	for (int i = 0; i < numJoints; ++i)
+	{
+		DancerJoint & jt = joints[i];
+		
+		jt.x = state.x[i];
+		jt.y = state.y[i];
+		jt.vx = state.vx[i];
+		jt.vy = state.vy[i];
+		jt.ax = state.ax[i];
+		jt.ay = state.ay[i];
+	}
 }
 
 void Dancer::draw() const
@@ -536,6 +1057,12 @@ void Dancer::draw() const
 
 void Dancer::blendTo(const Dancer & target, const double amount)
 {
+	if (!hasSameTopology(target))
+	{
+		*this = target;
+		return;
+	}
+	
 	for (int i = 0; i < numSprings; ++i)
 	{
 		DancerSpring & dst = springs[i];
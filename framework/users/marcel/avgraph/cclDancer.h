@@ -1,8 +1,19 @@
 #pragma once
 
+#include <stdint.h>
+#include <vector>
+
 static const int kMaxJoints = 128;
 static const int kMaxSprings = 1024;
 
+// the batched spring solver processes kSpringBatchSize springs at once. springs are grouped into colors
+// such that no two springs of the same color share a joint. greedy coloring needs at most 2 * max degree - 1
+// colors, and each color is padded to a multiple of the batch size
+
+static const int kSpringBatchSize = 4;
+static const int kMaxSpringColors = kMaxJoints * 2;
+static const int kMaxSpringSlots = kMaxSprings + kMaxSpringColors * (kSpringBatchSize - 1);
+
 enum FitnessFunction
 {
 	kFitnessFunction_GetSmall,
@@ -13,6 +24,47 @@ enum FitnessFunction
 
 const char * getFitnessFunctionName(FitnessFunction f);
 
+// small random number generator, so each dancer can draw random numbers independently of the others. this
+// makes it safe to randomize, breed and mutate dancers on different threads, and makes the outcome
+// independent of the order in which they are processed
+
+struct DancerRandom
+{
+	uint64_t state;
+	
+	DancerRandom()
+		: state(0)
+	{
+	}
+	
+	void seed(const uint64_t _state)
+	{
+		state = _state;
+	}
+	
+	uint64_t next()
+	{
+		// splitmix64
+		
+		uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+	
+	int nextInt(const int count)
+	{
+		return int(next() % uint64_t(count));
+	}
+	
+	double nextDouble(const double min, const double max)
+	{
+		const double t = (next() >> 11) * (1.0 / 9007199254740992.0);
+		
+		return min + (max - min) * t;
+	}
+};
+
 struct DancerJoint
 {
 	double x;
@@ -70,6 +122,7 @@ struct DancerEnv
 	bool useDistanceConstraint;
 	bool useSprings;
 	bool useSpasms;
+	bool useReferenceSolver;
 	double xFactor;
 	double yFactor;
 	LiveData liveData;
@@ -84,6 +137,7 @@ struct DancerEnv
 		, useDistanceConstraint(true)
 		, useSprings(false)
 		, useSpasms(false)
+		, useReferenceSolver(false)
 		, xFactor(1.0)
 		, yFactor(1.0)
 		, liveData()
@@ -94,11 +148,9 @@ struct DancerEnv
 
 struct Dancer
 {
-	DancerJoint joints[kMaxJoints];
-	DancerSpring springs[kMaxSprings];
-	
 	int numJoints;
 	int numSprings;
+	int numSpringSlots;
 	
 	double dampeningPerSecond;
 	
@@ -109,8 +161,24 @@ struct Dancer
 	
 	double totalFitnessValue;
 	
+	DancerRandom rng;
+	
+	// note : the joints, springs and spring slots are sized to their actual counts. assigning one dancer to
+	//        another reuses the storage of the destination, so breeding a new generation doesn't allocate once
+	//        the dancers have grown to their size
+	
+	std::vector<DancerJoint> joints;
+	std::vector<DancerSpring> springs;
+	
+	// spring indices, ordered such that each batch of kSpringBatchSize springs touches every joint at most once.
+	// padding slots are set to -1. computed by calculateSpringSlots
+	
+	std::vector<short> springSlots;
+	
 	Dancer();
 	
+	void reset();
+	
 	void calculateMinMax(double * min, double * max) const;
 	
 	double calculateFitness(const FitnessFunction fitnessFunction) const;
@@ -118,11 +186,27 @@ struct Dancer
 	void randomize();
 	void randomizeSpringFactors();
 	void constructFromPoints(const float * xyz, const int numPoints);
+	
+	// constructs a dancer with the same joints and springs as a dancer which was just constructed from points,
+	// with its own spring factors. the result is the same as constructing the dancer from the same points
+	
+	void constructFromDancer(const Dancer & other);
+	
 	void finalize();
+	void calculateSpringSlots();
+	
+	// returns true when both dancers have the same joints and springs, so their springs can be mixed
+	
+	bool hasSameTopology(const Dancer & other) const;
 	
 	void tick(const double dt, const FitnessFunction fitnessFunction);
+	void tickReference(const double dtReal, const int numSteps, const double dampeningPerStep);
+	void tickBatched(const double dtReal, const int numSteps, const double dampeningPerStep);
 	void draw() const;
 	
+	// blends the spring factors towards those of the target. when the target has a different topology, the
+	// dancer becomes a copy of the target instead
+	
 	void blendTo(const Dancer & target, const double amount);
 };
 
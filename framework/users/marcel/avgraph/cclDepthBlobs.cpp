@@ -0,0 +1,379 @@
+#include "cclDepthBlobs.h"
+#include "framework.h"
+#include <algorithm>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CCL_USE_SSE 1
+	#include <emmintrin.h>
+#else
+	#define CCL_USE_SSE 0
+#endif
+
+CclDepthBlobDetector::CclDepthBlobDetector()
+	: background(nullptr)
+	, resetCount(0)
+	, runs()
+	, stats()
+	, rowFirstRun()
+	, previousBlobs()
+	, numPreviousBlobs(0)
+	, nextBlobId(0)
+{
+	background = new float[kWidth * kHeight]();
+}
+
+CclDepthBlobDetector::~CclDepthBlobDetector()
+{
+	delete [] background;
+	background = nullptr;
+}
+
+void CclDepthBlobDetector::detect(const uint16_t * depth, const CclDepthBlobSettings & settings, CclDepthBlobs & result)
+{
+	if (settings.resetCount != resetCount)
+	{
+		memset(background, 0, kWidth * kHeight * sizeof(float));
+		
+		resetCount = settings.resetCount;
+	}
+	
+	updateBackground(depth, settings, result.mask);
+	
+	findRuns(result.mask);
+	
+	labelRuns();
+	
+	findBlobs(depth, settings, result);
+	
+	trackBlobs(result);
+}
+
+void CclDepthBlobDetector::updateBackground(const uint16_t * __restrict depth, const CclDepthBlobSettings & settings, uint8_t * __restrict mask)
+{
+	// note : pixels without depth have a depth of zero. they're never foreground, and leave the background alone
+	
+	const int minDepth = std::max(settings.minDepth, 1);
+	const int maxDepth = settings.maxDepth;
+	
+	int i = 0;
+	
+#if CCL_USE_SSE
+	const __m128 zero4 = _mm_setzero_ps();
+	const __m128 threshold4 = _mm_set1_ps(settings.threshold);
+	const __m128 minDepth4 = _mm_set1_ps(minDepth);
+	const __m128 maxDepth4 = _mm_set1_ps(maxDepth);
+	const __m128 learnRate4 = _mm_set1_ps(settings.learnRate);
+	
+	for (; i + 16 <= kWidth * kHeight; i += 16)
+	{
+		const __m128i depth16[2] =
+		{
+			_mm_loadu_si128((const __m128i*)(depth + i + 0)),
+			_mm_loadu_si128((const __m128i*)(depth + i + 8))
+		};
+		
+		__m128i isForeground[4];
+		
+		for (int k = 0; k < 4; ++k)
+		{
+			const __m128i d32 = (k & 1) == 0
+				? _mm_unpacklo_epi16(depth16[k >> 1], _mm_setzero_si128())
+				: _mm_unpackhi_epi16(depth16[k >> 1], _mm_setzero_si128());
+			
+			const __m128 d = _mm_cvtepi32_ps(d32);
+			const __m128 b = _mm_loadu_ps(background + i + k * 4);
+			
+			const __m128 hasDepth = _mm_cmpgt_ps(d, zero4);
+			const __m128 isKnown = _mm_cmpgt_ps(b, zero4);
+			
+			const __m128 foreground = _mm_and_ps(
+				_mm_and_ps(isKnown, _mm_cmpgt_ps(_mm_sub_ps(b, d), threshold4)),
+				_mm_and_ps(_mm_cmpge_ps(d, minDepth4), _mm_cmple_ps(d, maxDepth4)));
+			
+			// unknown background is learned at once. known background moves towards the depth at the learn rate
+			
+			const __m128 learned = _mm_or_ps(
+				_mm_and_ps(isKnown, _mm_add_ps(b, _mm_mul_ps(_mm_sub_ps(d, b), learnRate4))),
+				_mm_andnot_ps(isKnown, d));
+			
+			const __m128 update = _mm_andnot_ps(foreground, hasDepth);
+			
+			_mm_storeu_ps(background + i + k * 4, _mm_or_ps(_mm_and_ps(update, learned), _mm_andnot_ps(update, b)));
+			
+			isForeground[k] = _mm_castps_si128(foreground);
+		}
+		
+		// the comparison results are all ones or all zeros, and pack into 255 and 0 respectively
+		
+		_mm_storeu_si128((__m128i*)(mask + i), _mm_packs_epi16(
+			_mm_packs_epi32(isForeground[0], isForeground[1]),
+			_mm_packs_epi32(isForeground[2], isForeground[3])));
+	}
+#endif
+	
+	for (; i < kWidth * kHeight; ++i)
+	{
+		const float d = depth[i];
+		const float b = background[i];
+		
+		const bool hasDepth = d > 0.f;
+		const bool isKnown = b > 0.f;
+		
+		const bool foreground = isKnown && b - d > settings.threshold && d >= minDepth && d <= maxDepth;
+		
+		if (hasDepth && !foreground)
+			background[i] = isKnown ? b + (d - b) * settings.learnRate : d;
+		
+		mask[i] = foreground ? 255 : 0;
+	}
+}
+
+void CclDepthBlobDetector::findRuns(const uint8_t * mask)
+{
+	runs.clear();
+	
+	for (int y = 0; y < kHeight; ++y)
+	{
+		rowFirstRun[y] = runs.size();
+		
+		const uint8_t * line = mask + y * kWidth;
+		
+		int x = 0;
+		
+		while (x < kWidth)
+		{
+			// skip the background eight pixels at a time
+			
+			if ((x & 7) == 0 && x + 8 <= kWidth)
+			{
+				uint64_t value;
+				memcpy(&value, line + x, 8);
+				
+				if (value == 0)
+				{
+					x += 8;
+					continue;
+				}
+			}
+			
+			if (line[x] == 0)
+			{
+				x++;
+				continue;
+			}
+			
+			Run run;
+			run.y = y;
+			run.begin = x;
+			
+			while (x < kWidth && line[x] != 0)
+				x++;
+			
+			run.end = x;
+			run.parent = runs.size();
+			
+			runs.push_back(run);
+		}
+	}
+	
+	rowFirstRun[kHeight] = runs.size();
+}
+
+int CclDepthBlobDetector::findRoot(int index)
+{
+	while (runs[index].parent != index)
+	{
+		// path halving
+		
+		runs[index].parent = runs[runs[index].parent].parent;
+		
+		index = runs[index].parent;
+	}
+	
+	return index;
+}
+
+void CclDepthBlobDetector::labelRuns()
+{
+	// connects the runs which touch a run on the previous row, including diagonally. the root of a set of
+	// connected runs is always the run with the lowest index, which is the first run of the blob
+	
+	for (int y = 1; y < kHeight; ++y)
+	{
+		const int prevBegin = rowFirstRun[y - 1];
+		const int prevEnd = rowFirstRun[y];
+		const int currEnd = rowFirstRun[y + 1];
+		
+		int j = prevBegin;
+		
+		for (int i = prevEnd; i < currEnd; ++i)
+		{
+			const Run & run = runs[i];
+			
+			while (j < prevEnd && runs[j].end < run.begin)
+				j++;
+			
+			for (int k = j; k < prevEnd && runs[k].begin <= run.end; ++k)
+			{
+				const int root1 = findRoot(i);
+				const int root2 = findRoot(k);
+				
+				if (root1 < root2)
+					runs[root2].parent = root1;
+				else if (root2 < root1)
+					runs[root1].parent = root2;
+			}
+		}
+	}
+}
+
+void CclDepthBlobDetector::findBlobs(const uint16_t * depth, const CclDepthBlobSettings & settings, CclDepthBlobs & result)
+{
+	const int numRuns = runs.size();
+	
+	stats.resize(numRuns);
+	
+	// accumulate the statistics of each blob at its root. roots come before the other runs of their blob
+	
+	for (int i = 0; i < numRuns; ++i)
+	{
+		Run & run = runs[i];
+		
+		run.parent = findRoot(i);
+		
+		BlobStats & s = stats[run.parent];
+		
+		if (run.parent == i)
+		{
+			s.area = 0;
+			s.sumX = 0;
+			s.sumY = 0;
+			s.sumZ = 0;
+			s.minX = run.begin;
+			s.minY = run.y;
+			s.maxX = run.end - 1;
+			s.maxY = run.y;
+			s.blobIndex = -1;
+		}
+		
+		const int length = run.end - run.begin;
+		
+		const uint16_t * depthLine = depth + run.y * kWidth;
+		
+		int sumZ = 0;
+		
+		for (int x = run.begin; x < run.end; ++x)
+			sumZ += depthLine[x];
+		
+		s.area += length;
+		s.sumX += length * (run.begin + run.end - 1) / 2;
+		s.sumY += length * run.y;
+		s.sumZ += sumZ;
+		s.minX = std::min(s.minX, (int)run.begin);
+		s.maxX = std::max(s.maxX, run.end - 1);
+		s.maxY = run.y;
+	}
+	
+	// keep the largest blobs
+	
+	int blobRoots[CclDepthBlobs::kMaxBlobs];
+	int numBlobs = 0;
+	
+	for (int i = 0; i < numRuns; ++i)
+	{
+		if (runs[i].parent != i || stats[i].area < settings.minArea)
+			continue;
+		
+		if (numBlobs == CclDepthBlobs::kMaxBlobs)
+		{
+			if (stats[i].area <= stats[blobRoots[numBlobs - 1]].area)
+				continue;
+			
+			numBlobs--;
+		}
+		
+		int index = numBlobs++;
+		
+		for (; index > 0 && stats[blobRoots[index - 1]].area < stats[i].area; --index)
+			blobRoots[index] = blobRoots[index - 1];
+		
+		blobRoots[index] = i;
+	}
+	
+	result.numBlobs = numBlobs;
+	
+	for (int i = 0; i < numBlobs; ++i)
+	{
+		BlobStats & s = stats[blobRoots[i]];
+		
+		s.blobIndex = i;
+		
+		CclDepthBlob & blob = result.blobs[i];
+		
+		blob.id = -1;
+		blob.area = s.area;
+		blob.x = s.sumX / double(s.area);
+		blob.y = s.sumY / double(s.area);
+		blob.z = s.sumZ / double(s.area);
+		blob.minX = s.minX;
+		blob.minY = s.minY;
+		blob.maxX = s.maxX;
+		blob.maxY = s.maxY;
+	}
+	
+	// remove the discarded blobs from the mask
+	
+	for (int i = 0; i < numRuns; ++i)
+	{
+		const Run & run = runs[i];
+		
+		if (stats[run.parent].blobIndex < 0)
+			memset(result.mask + run.y * kWidth + run.begin, 0, run.end - run.begin);
+	}
+}
+
+void CclDepthBlobDetector::trackBlobs(CclDepthBlobs & result)
+{
+	// match each blob with the closest blob of the previous frame, from the largest blob to the smallest
+	
+	bool isMatched[CclDepthBlobs::kMaxBlobs] = { };
+	
+	for (int i = 0; i < result.numBlobs; ++i)
+	{
+		CclDepthBlob & blob = result.blobs[i];
+		
+		int bestIndex = -1;
+		float bestDistanceSq = kMaxTrackingDistance * kMaxTrackingDistance;
+		
+		for (int j = 0; j < numPreviousBlobs; ++j)
+		{
+			if (isMatched[j])
+				continue;
+			
+			const float dx = blob.x - previousBlobs[j].x;
+			const float dy = blob.y - previousBlobs[j].y;
+			const float distanceSq = dx * dx + dy * dy;
+			
+			if (distanceSq < bestDistanceSq)
+			{
+				bestIndex = j;
+				bestDistanceSq = distanceSq;
+			}
+		}
+		
+		if (bestIndex >= 0)
+		{
+			isMatched[bestIndex] = true;
+			
+			blob.id = previousBlobs[bestIndex].id;
+		}
+		else
+		{
+			blob.id = nextBlobId++;
+		}
+	}
+	
+	memcpy(previousBlobs, result.blobs, result.numBlobs * sizeof(CclDepthBlob));
+	numPreviousBlobs = result.numBlobs;
+}
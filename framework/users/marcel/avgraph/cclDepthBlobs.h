@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+/*
+
+CclDepthBlobDetector finds the people and objects standing in front of the background in kinect depth frames.
+it keeps a running average of the depth of the background, and marks the pixels which are closer than the
+background by more than a threshold as foreground. the foreground is split into connected blobs, and the area,
+centroid, mean depth and bounds of each blob are computed. blobs are matched with the blobs of the previous
+frame, so a blob keeps its id while it moves around.
+
+the background starts out unknown, and is learned from the first frame with depth for each pixel. after that,
+it's updated for the pixels which are not part of the foreground, at the learn rate. resetting the background
+makes it learn the background anew, which should happen when the space in front of the camera is empty.
+
+the foreground is labeled as runs of pixels, rather than pixel by pixel, so the cost of labeling depends on
+the number of runs and not on the number of pixels.
+
+usage:
+	
+	CclDepthBlobDetector detector;
+	CclDepthBlobSettings settings;
+	
+	CclDepthBlobs * blobs = new CclDepthBlobs();
+	
+	detector.detect((const uint16_t*)depthFrame->data, settings, *blobs);
+	
+	for (int i = 0; i < blobs->numBlobs; ++i)
+		logDebug("blob %d at (%.2f, %.2f)", blobs->blobs[i].id, blobs->blobs[i].x, blobs->blobs[i].y);
+
+*/
+
+struct CclDepthBlob
+{
+	int id; // stays the same while the blob is tracked from frame to frame
+	
+	int area; // in pixels
+	
+	float x; // the centroid, in pixels
+	float y;
+	float z; // the mean depth, in millimeters
+	
+	int minX; // the bounds, in pixels. inclusive
+	int minY;
+	int maxX;
+	int maxY;
+};
+
+struct CclDepthBlobs
+{
+	static const int kWidth = 640;
+	static const int kHeight = 480;
+	
+	static const int kMaxBlobs = 32;
+	
+	uint8_t mask[kWidth * kHeight]; // 255 for the pixels which are part of a blob. 0 otherwise
+	
+	CclDepthBlob blobs[kMaxBlobs]; // sorted by area, from large to small
+	int numBlobs;
+};
+
+struct CclDepthBlobSettings
+{
+	int threshold; // how much closer than the background a pixel must be to be foreground, in millimeters
+	
+	int minDepth; // pixels outside the depth range are never foreground, in millimeters
+	int maxDepth;
+	
+	float learnRate; // how far the background moves towards the depth of background pixels, per frame
+	
+	int minArea; // blobs smaller than this are discarded, in pixels
+	
+	int resetCount; // increment to make the detector learn the background anew
+	
+	CclDepthBlobSettings()
+		: threshold(100)
+		, minDepth(0)
+		, maxDepth(10000)
+		, learnRate(.01f)
+		, minArea(400)
+		, resetCount(0)
+	{
+	}
+};
+
+struct CclDepthBlobDetector
+{
+	static const int kWidth = CclDepthBlobs::kWidth;
+	static const int kHeight = CclDepthBlobs::kHeight;
+	
+	static const int kMaxTrackingDistance = 64; // in pixels
+	
+	struct Run
+	{
+		short y;
+		short begin; // inclusive
+		short end; // exclusive
+		int parent;
+	};
+	
+	struct BlobStats
+	{
+		int area;
+		int64_t sumX;
+		int64_t sumY;
+		int64_t sumZ;
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+		int blobIndex;
+	};
+	
+	float * background; // the average depth of the background, or zero when it's unknown
+	
+	int resetCount;
+	
+	std::vector<Run> runs;
+	std::vector<BlobStats> stats;
+	
+	int rowFirstRun[kHeight + 1]; // the index of the first run of each row. the last element is the number of runs
+	
+	CclDepthBlob previousBlobs[CclDepthBlobs::kMaxBlobs];
+	int numPreviousBlobs;
+	int nextBlobId;
+	
+	CclDepthBlobDetector();
+	~CclDepthBlobDetector();
+	
+	void detect(const uint16_t * depth, const CclDepthBlobSettings & settings, CclDepthBlobs & result);
+	
+private:
+	void updateBackground(const uint16_t * depth, const CclDepthBlobSettings & settings, uint8_t * mask);
+	void findRuns(const uint8_t * mask);
+	void labelRuns();
+	void findBlobs(const uint16_t * depth, const CclDepthBlobSettings & settings, CclDepthBlobs & result);
+	void trackBlobs(CclDepthBlobs & result);
+	
+	int findRoot(int index);
+	
+	CclDepthBlobDetector(const CclDepthBlobDetector & other);
+	CclDepthBlobDetector & operator=(const CclDepthBlobDetector & other);
+};
@@ -1,10 +1,127 @@
 #include "cclKinect.h"
 #include "framework.h"
+#include <algorithm>
+#include <string.h>
 
 #include "freenect_internal.h" // for access to freenect_device.registration.zero_plane_info
 
+CclKinectManager g_kinectManager;
+
+CclKinectConsumer::CclKinectConsumer(const CclKinectStream _stream, const int dataSize)
+	: stream(_stream)
+	, frames()
+	, exchange()
+	, pointCloudConverter()
+	, blobSettings()
+	, blobSettingsExchange()
+	, blobDetector(nullptr)
+{
+	for (int i = 0; i < 3; ++i)
+		frames[i].data = malloc(dataSize);
+	
+	SDL_AtomicSet(&pointCloudStride, 1);
+	SDL_AtomicSet(&pointCloudMinDepth, 0);
+	SDL_AtomicSet(&pointCloudMaxDepth, 10000);
+	
+	if (stream == kCclKinectStream_Blobs)
+		blobDetector = new CclDepthBlobDetector();
+}
+
+CclKinectConsumer::~CclKinectConsumer()
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		free(frames[i].data);
+		frames[i].data = nullptr;
+	}
+	
+	delete blobDetector;
+	blobDetector = nullptr;
+}
+
+const CclKinectFrame * CclKinectConsumer::acquireFrame()
+{
+	if (exchange.acquire())
+		return &frames[exchange.readIndex];
+	else
+		return nullptr;
+}
+
+void CclKinectConsumer::convertPointCloud(const uint16_t * depth, const float referencePixelSize, const float referenceDistance, CclKinectFrame & frame)
+{
+	const int stride = std::max(1, SDL_AtomicGet(&pointCloudStride));
+	
+	if (pointCloudConverter.stride != stride)
+	{
+		pointCloudConverter.init(referencePixelSize, referenceDistance, stride);
+	}
+	
+	frame.sx = pointCloudConverter.sx;
+	frame.sy = pointCloudConverter.sy;
+	frame.numPoints = pointCloudConverter.convert(
+		depth,
+		SDL_AtomicGet(&pointCloudMinDepth),
+		SDL_AtomicGet(&pointCloudMaxDepth),
+		(float*)frame.data);
+}
+
+void CclKinectConsumer::detectBlobs(const uint16_t * depth, CclKinectFrame & frame)
+{
+	// note : the settings at readIndex stay in effect until the consumer publishes new settings
+	
+	blobSettingsExchange.acquire();
+	
+	blobDetector->detect(depth, blobSettings[blobSettingsExchange.readIndex], *(CclDepthBlobs*)frame.data);
+}
+
+//
+
 bool CclKinect::init()
 {
+	//We have to do this as freenect has 488 pixels for the IR image height.
+	//Instead of having slightly different sizes depending on capture we will crop the last 8 rows of pixels which are empty.
+	int videoHeight = height;
+	if (bIsVideoInfrared)
+		videoHeight = 488;
+	
+	depthDataSize = width * height * 2;
+	videoDataSize = width * videoHeight * (bIsVideoInfrared ? 1 : 3);
+	
+	for (int i = 0; i < 3; ++i)
+	{
+		videoFrames[i].data = malloc(videoDataSize);
+		depthFrames[i].data = malloc(depthDataSize);
+	}
+	
+	processingThread = SDL_CreateThread(processingThreadMain, "Kinect Processing Thread", this);
+	
+	if (isReplay())
+	{
+		// replay frames from a recording, on a thread of its own, the same way frames arrive from a device
+		
+		const std::string videoFilename = replayFilename + ".video";
+		const std::string depthFilename = replayFilename + ".depth";
+		
+		const bool hasVideo = replayVideoFile.open(videoFilename.c_str());
+		const bool hasDepth = replayDepthFile.open(depthFilename.c_str());
+		
+		if (!hasVideo && !hasDepth)
+		{
+			logError("failed to open recording: %s", replayFilename.c_str());
+			shut();
+			return false;
+		}
+		
+		if (!hasVideo)
+			logWarning("recording has no video frames: %s", videoFilename.c_str());
+		if (!hasDepth)
+			logWarning("recording has no depth frames: %s", depthFilename.c_str());
+		
+		thread = SDL_CreateThread(threadMain, "Kinect Replay Thread", this);
+		
+		return true;
+	}
+	
 	Assert(context == nullptr);
 	if (freenect_init(&context, nullptr) < 0)
 	{
@@ -18,26 +135,19 @@ bool CclKinect::init()
 	
 	//
 	
-	std::string serial;
-	
-	//
-	
-	freenect_device_attributes * devAttrib = nullptr;
-	
-	const int numDevices = freenect_list_device_attributes(context, &devAttrib);
-	
-	for (int i = 0; i < numDevices; ++i)
+	if (serial.empty())
 	{
-		logDebug("camera serial: %s", devAttrib->camera_serial);
+		freenect_device_attributes * devAttribList = nullptr;
 		
-		serial = devAttrib->camera_serial;
+		if (freenect_list_device_attributes(context, &devAttribList) > 0)
+		{
+			serial = devAttribList->camera_serial;
+		}
 		
-		devAttrib = devAttrib->next;
+		freenect_free_device_attributes(devAttribList);
+		devAttribList = nullptr;
 	}
 	
-	freenect_free_device_attributes(devAttrib);
-	devAttrib = nullptr;
-	
 	//
 	
 	bool deviceHasMotorControl = false;
@@ -53,11 +163,14 @@ bool CclKinect::init()
 		Assert(device == nullptr);
 		if (freenect_open_device_by_camera_serial(context, &device, serial.c_str()) < 0)
 		{
-			logError("failed to open camera");
+			logError("failed to open camera: %s", serial.c_str());
 			shut();
 			return false;
 		}
 		
+		referencePixelSize = device->registration.zero_plane_info.reference_pixel_size;
+		referenceDistance = device->registration.zero_plane_info.reference_distance;
+		
 		if (serial == "0000000000000000")
 		{
 			//if we do motor control via the audio device ( ie: 1473 or k4w ) and we have firmware uploaded
@@ -76,7 +189,6 @@ bool CclKinect::init()
 			deviceHasMotorControl = true;
 		}
 		
-		mutex = SDL_CreateMutex();
 		thread = SDL_CreateThread(threadMain, "Kinect Thread", this);
 		
 		//threadInit();
@@ -91,35 +203,67 @@ bool CclKinect::shut()
 {
 	if (thread != nullptr)
 	{
-		SDL_LockMutex(mutex);
-		{
-			stopThread = true;
-		}
-		SDL_UnlockMutex(mutex);
+		SDL_AtomicSet(&stopThread, 1);
 		
 		SDL_WaitThread(thread, nullptr);
+		thread = nullptr;
 		
-		SDL_DestroyMutex(mutex);
-		mutex = nullptr;
+		SDL_AtomicSet(&stopThread, 0);
+	}
+	
+	// note : the processing thread is stopped after the kinect thread, so it doesn't get any new frames to process
+	
+	if (processingThread != nullptr)
+	{
+		SDL_AtomicSet(&stopProcessingThread, 1);
+		SDL_SemPost(frameSemaphore);
 		
-		stopThread = false;
+		SDL_WaitThread(processingThread, nullptr);
+		processingThread = nullptr;
+		
+		SDL_AtomicSet(&stopProcessingThread, 0);
 	}
 	
-	for (int i = 0; i < 2; ++i)
+	if (videoCaptureBuffer != nullptr)
 	{
-		if (videoData[i] != nullptr)
-		{
-			free(videoData[i]);
-			videoData[i] = nullptr;
-		}
+		free(videoCaptureBuffer);
+		videoCaptureBuffer = nullptr;
+	}
+	
+	if (depthCaptureBuffer != nullptr)
+	{
+		free(depthCaptureBuffer);
+		depthCaptureBuffer = nullptr;
+	}
+	
+	for (int i = 0; i < 3; ++i)
+	{
+		free(videoFrames[i].data);
+		videoFrames[i].data = nullptr;
 		
-		if (depthData[i] != nullptr)
-		{
-			free(depthData[i]);
-			depthData[i] = nullptr;
-		}
+		free(depthFrames[i].data);
+		depthFrames[i].data = nullptr;
 	}
 	
+	// note : consumers should be removed by their owners before the kinect is shut down
+	
+	Assert(consumers.empty());
+	
+	for (auto * consumer : consumers)
+		delete consumer;
+	
+	consumers.clear();
+	
+	for (auto * consumer : retiredConsumers)
+		delete consumer;
+	
+	retiredConsumers.clear();
+	
+	processingConsumers.clear();
+	
+	replayVideoFile.close();
+	replayDepthFile.close();
+	
 	if (device != nullptr)
 	{
 		freenect_close_device(device);
@@ -135,8 +279,49 @@ bool CclKinect::shut()
 	return true;
 }
 
+bool CclKinect::listDevices(std::vector<std::string> & serials)
+{
+	freenect_context * context = nullptr;
+	
+	if (freenect_init(&context, nullptr) < 0)
+	{
+		logError("freenect_init failed");
+		return false;
+	}
+	
+	freenect_set_log_level(context, FREENECT_LOG_WARNING);
+	freenect_select_subdevices(context, FREENECT_DEVICE_CAMERA);
+	
+	freenect_device_attributes * devAttribList = nullptr;
+	
+	freenect_list_device_attributes(context, &devAttribList);
+	
+	for (freenect_device_attributes * devAttrib = devAttribList; devAttrib != nullptr; devAttrib = devAttrib->next)
+	{
+		logDebug("camera serial: %s", devAttrib->camera_serial);
+		
+		serials.push_back(devAttrib->camera_serial);
+	}
+	
+	freenect_free_device_attributes(devAttribList);
+	devAttribList = nullptr;
+	
+	freenect_shutdown(context);
+	context = nullptr;
+	
+	return true;
+}
+
 void CclKinect::threadInit()
 {
+	if (isReplay())
+	{
+		replayStartTime = SDL_GetTicks();
+		replayFrameIndex = 0;
+		
+		return;
+	}
+	
 	//freenect_set_flag(device, FREENECT_AUTO_EXPOSURE, FREENECT_ON);
 	//freenect_set_flag(device, FREENECT_AUTO_WHITE_BALANCE, FREENECT_ON);
 	//freenect_set_flag(device, FREENECT_MIRROR_DEPTH, FREENECT_ON);
@@ -164,29 +349,18 @@ void CclKinect::threadInit()
 		logError("failed to set depth mode");
 	}
 	
-	//We have to do this as freenect has 488 pixels for the IR image height.
-	//Instead of having slightly different sizes depending on capture we will crop the last 8 rows of pixels which are empty.
-	int videoHeight = height;
-	if (bIsVideoInfrared)
-		videoHeight = 488;
-	
-	const int depthDataSize = width * height * 2;
-	const int videoDataSize = width * videoHeight * (bIsVideoInfrared ? 1 : 3);
-	
 	Assert(depthDataSize == depthMode.bytes);
 	Assert(videoDataSize == videoMode.bytes);
 	
-	depthData[0] = malloc(depthDataSize);
-	depthData[1] = malloc(depthDataSize);
-	videoData[0] = malloc(videoDataSize);
-	videoData[1] = malloc(videoDataSize);
+	depthCaptureBuffer = malloc(depthDataSize);
+	videoCaptureBuffer = malloc(videoDataSize);
 	
 	freenect_set_user(device, this);
 	
-	freenect_set_depth_buffer(device, depthData[0]);
+	freenect_set_depth_buffer(device, depthCaptureBuffer);
 	freenect_set_depth_callback(device, &grabDepthFrame);
 	
-	freenect_set_video_buffer(device, videoData[0]);
+	freenect_set_video_buffer(device, videoCaptureBuffer);
 	freenect_set_video_callback(device, &grabVideoFrame);
 
 	freenect_set_led(device, currentLed);
@@ -227,6 +401,11 @@ void CclKinect::threadShut()
 
 bool CclKinect::threadProcess()
 {
+	if (isReplay())
+	{
+		return threadProcessReplay();
+	}
+	
 	if (context == nullptr)
 	{
 		return false;
@@ -264,6 +443,44 @@ bool CclKinect::threadProcess()
 	return true;
 }
 
+static const void * getReplayFrame(const MappedFile & file, const int frameIndex, const int dataSize)
+{
+	const int numFrames = file.size / dataSize;
+	
+	if (numFrames == 0)
+		return nullptr;
+	
+	return (const uint8_t*)file.data + size_t(frameIndex % numFrames) * dataSize;
+}
+
+bool CclKinect::threadProcessReplay()
+{
+	// wait for the time of the next frame to arrive. recordings are replayed at the rate the kinect captures frames
+	
+	const uint32_t time = SDL_GetTicks() - replayStartTime;
+	const uint32_t frameTime = uint32_t(uint64_t(replayFrameIndex) * 1000 / kReplayFrameRate);
+	
+	if (time < frameTime)
+	{
+		SDL_Delay(frameTime - time);
+		
+		return true;
+	}
+	
+	const void * videoData = replayVideoFile.isOpen() ? getReplayFrame(replayVideoFile, replayFrameIndex, videoDataSize) : nullptr;
+	const void * depthData = replayDepthFile.isOpen() ? getReplayFrame(replayDepthFile, replayFrameIndex, depthDataSize) : nullptr;
+	
+	if (videoData != nullptr)
+		submitVideoFrame(videoData, frameTime);
+	
+	if (depthData != nullptr)
+		submitDepthFrame(depthData, frameTime);
+	
+	replayFrameIndex++;
+	
+	return true;
+}
+
 int CclKinect::threadMain(void * userData)
 {
 	CclKinect * self = (CclKinect*)userData;
@@ -272,15 +489,7 @@ int CclKinect::threadMain(void * userData)
 	
 	for (;;)
 	{
-		bool stop = false;
-		
-		SDL_LockMutex(self->mutex);
-		{
-			stop = self->stopThread;
-		}
-		SDL_UnlockMutex(self->mutex);
-		
-		if (stop)
+		if (SDL_AtomicGet(&self->stopThread) != 0)
 		{
 			break;
 		}
@@ -294,23 +503,220 @@ int CclKinect::threadMain(void * userData)
 	return 0;
 }
 
-void CclKinect::grabDepthFrame(freenect_device * dev, void * depth, uint32_t timestamp)
+void CclKinect::processingThreadInit()
 {
-	//logDebug("got depth frame: %u", timestamp);
+	if (!recordFilename.empty() && !isReplay())
+	{
+		const std::string videoFilename = recordFilename + ".video";
+		const std::string depthFilename = recordFilename + ".depth";
+		
+		recordVideoFile = fopen(videoFilename.c_str(), "wb");
+		recordDepthFile = fopen(depthFilename.c_str(), "wb");
+		
+		if (recordVideoFile == nullptr || recordDepthFile == nullptr)
+			logError("failed to open recording for write: %s", recordFilename.c_str());
+	}
+}
+
+void CclKinect::processingThreadShut()
+{
+	if (recordVideoFile != nullptr)
+	{
+		fclose(recordVideoFile);
+		recordVideoFile = nullptr;
+	}
 	
-	CclKinect * self = (CclKinect*)dev->user_data;
+	if (recordDepthFile != nullptr)
+	{
+		fclose(recordDepthFile);
+		recordDepthFile = nullptr;
+	}
+}
+
+void CclKinect::processingThreadProcess()
+{
+	// work with a copy of the list of consumers, so adding and removing consumers doesn't have to wait for the
+	// frames to be processed. the consumers removed since the last copy was made are no longer in use by us,
+	// so they can be deleted now
+	
+	SDL_LockMutex(consumerMutex);
+	{
+		processingConsumers = consumers;
+		
+		for (auto * consumer : retiredConsumers)
+			delete consumer;
+		
+		retiredConsumers.clear();
+	}
+	SDL_UnlockMutex(consumerMutex);
+	
+	// note : frames are recorded here rather than on the kinect thread. when writing can't keep up, the kinect
+	//        thread keeps overwriting the latest frame, and the frames in between are missing from the recording
+	
+	if (videoExchange.acquire())
+	{
+		const CclKinectFrame & frame = videoFrames[videoExchange.readIndex];
+		
+		if (recordVideoFile != nullptr)
+			fwrite(frame.data, videoDataSize, 1, recordVideoFile);
+		
+		publishVideoFrame(frame);
+	}
+	
+	if (depthExchange.acquire())
+	{
+		const CclKinectFrame & frame = depthFrames[depthExchange.readIndex];
+		
+		if (recordDepthFile != nullptr)
+			fwrite(frame.data, depthDataSize, 1, recordDepthFile);
+		
+		publishDepthFrame(frame);
+	}
+}
+
+int CclKinect::processingThreadMain(void * userData)
+{
+	CclKinect * self = (CclKinect*)userData;
+	
+	self->processingThreadInit();
+	
+	for (;;)
+	{
+		SDL_SemWait(self->frameSemaphore);
+		
+		if (SDL_AtomicGet(&self->stopProcessingThread) != 0)
+		{
+			break;
+		}
+		
+		self->processingThreadProcess();
+	}
+	
+	self->processingThreadShut();
+	
+	return 0;
+}
+
+CclKinectConsumer * CclKinect::addConsumer(const CclKinectStream stream)
+{
+	const int dataSize =
+		stream == kCclKinectStream_Video ? videoDataSize :
+		stream == kCclKinectStream_Depth ? depthDataSize :
+		stream == kCclKinectStream_PointCloud ? int(width * height * 3 * sizeof(float)) :
+		int(sizeof(CclDepthBlobs));
+	
+	CclKinectConsumer * consumer = new CclKinectConsumer(stream, dataSize);
+	
+	SDL_LockMutex(consumerMutex);
+	{
+		consumers.push_back(consumer);
+	}
+	SDL_UnlockMutex(consumerMutex);
+	
+	return consumer;
+}
+
+void CclKinect::removeConsumer(CclKinectConsumer * consumer)
+{
+	SDL_LockMutex(consumerMutex);
+	{
+		auto i = std::find(consumers.begin(), consumers.end(), consumer);
+		
+		Assert(i != consumers.end());
+		if (i != consumers.end())
+			consumers.erase(i);
+		
+		// note : the processing thread may be handing a frame to the consumer right now. it deletes the consumer
+		//        once it's done with it
+		
+		retiredConsumers.push_back(consumer);
+	}
+	SDL_UnlockMutex(consumerMutex);
+}
+
+void CclKinect::submitVideoFrame(const void * data, const uint32_t timestamp)
+{
+	CclKinectFrame & frame = videoFrames[videoExchange.writeIndex];
+	
+	memcpy(frame.data, data, videoDataSize);
+	
+	frame.timestamp = timestamp;
+	frame.sequence = nextVideoSequence++;
+	
+	videoExchange.publish();
+	
+	SDL_SemPost(frameSemaphore);
+}
+
+void CclKinect::submitDepthFrame(const void * data, const uint32_t timestamp)
+{
+	CclKinectFrame & frame = depthFrames[depthExchange.writeIndex];
+	
+	memcpy(frame.data, data, depthDataSize);
+	
+	frame.timestamp = timestamp;
+	frame.sequence = nextDepthSequence++;
+	
+	depthExchange.publish();
+	
+	SDL_SemPost(frameSemaphore);
+}
+
+void CclKinect::publishVideoFrame(const CclKinectFrame & rawFrame)
+{
+	for (auto * consumer : processingConsumers)
+	{
+		if (consumer->stream != kCclKinectStream_Video)
+			continue;
+		
+		CclKinectFrame & frame = consumer->frames[consumer->exchange.writeIndex];
+		
+		memcpy(frame.data, rawFrame.data, videoDataSize);
+		
+		frame.timestamp = rawFrame.timestamp;
+		frame.sequence = rawFrame.sequence;
+		
+		consumer->exchange.publish();
+	}
+}
+
+void CclKinect::publishDepthFrame(const CclKinectFrame & rawFrame)
+{
+	const uint16_t * depth = (const uint16_t*)rawFrame.data;
 	
-	SDL_LockMutex(self->mutex);
+	for (auto * consumer : processingConsumers)
 	{
-		self->hasDepth = true;
-		self->depth = depth;
+		if (consumer->stream == kCclKinectStream_Video)
+			continue;
+		
+		CclKinectFrame & frame = consumer->frames[consumer->exchange.writeIndex];
+		
+		if (consumer->stream == kCclKinectStream_Depth)
+			memcpy(frame.data, depth, depthDataSize);
+		else if (consumer->stream == kCclKinectStream_PointCloud)
+			consumer->convertPointCloud(depth, referencePixelSize, referenceDistance, frame);
+		else if (consumer->stream == kCclKinectStream_Blobs)
+			consumer->detectBlobs(depth, frame);
 		
-		Assert(depth == self->depthData[0]);
+		frame.timestamp = rawFrame.timestamp;
+		frame.sequence = rawFrame.sequence;
 		
-		std::swap(self->depthData[0], self->depthData[1]);
-		freenect_set_depth_buffer(self->device, self->depthData[0]);
+		consumer->exchange.publish();
 	}
-	SDL_UnlockMutex(self->mutex);
+}
+
+void CclKinect::grabDepthFrame(freenect_device * dev, void * depth, uint32_t timestamp)
+{
+	//logDebug("got depth frame: %u", timestamp);
+	
+	CclKinect * self = (CclKinect*)dev->user_data;
+	
+	Assert(depth == self->depthCaptureBuffer);
+	
+	// note : the callback runs in between processing usb events, so all it does is copy the frame out and hand
+	//        it to the processing thread
+	
+	self->submitDepthFrame(depth, timestamp);
 }
 
 void CclKinect::grabVideoFrame(freenect_device * dev, void * video, uint32_t timestamp)
@@ -319,15 +725,176 @@ void CclKinect::grabVideoFrame(freenect_device * dev, void * video, uint32_t tim
 	
 	CclKinect * self = (CclKinect*)dev->user_data;
 	
-	SDL_LockMutex(self->mutex);
+	Assert(video == self->videoCaptureBuffer);
+	
+	self->submitVideoFrame(video, timestamp);
+}
+
+//
+
+CclKinectManager::CclKinectManager()
+	: configuredSerials()
+	, serials()
+	, hasListedDevices(false)
+	, devices()
+	, mutex(nullptr)
+{
+	mutex = SDL_CreateMutex();
+}
+
+CclKinectManager::~CclKinectManager()
+{
+	for (auto & device : devices)
 	{
-		self->hasVideo = true;
-		self->video = video;
+		device.kinect->shut();
 		
-		Assert(video == self->videoData[0]);
+		delete device.kinect;
+		device.kinect = nullptr;
+	}
+	
+	devices.clear();
+	
+	SDL_DestroyMutex(mutex);
+	mutex = nullptr;
+}
+
+const char * CclKinectManager::getSerial(const int index)
+{
+	const char * result = nullptr;
+	
+	SDL_LockMutex(mutex);
+	{
+		if (!configuredSerials.empty())
+		{
+			if (index >= 0 && index < (int)configuredSerials.size())
+				result = configuredSerials[index].c_str();
+		}
+		else
+		{
+			// note : devices are listed once, so indices don't change when a device is plugged in later on
+			
+			if (hasListedDevices == false)
+			{
+				hasListedDevices = true;
+				
+				CclKinect::listDevices(serials);
+			}
+			
+			if (index >= 0 && index < (int)serials.size())
+				result = serials[index].c_str();
+		}
+	}
+	SDL_UnlockMutex(mutex);
+	
+	return result;
+}
+
+CclKinect * CclKinectManager::openDevice(const char * serial, const bool infrared, const char * recordFilename)
+{
+	return open(serial, serial, nullptr, infrared, recordFilename);
+}
+
+CclKinect * CclKinectManager::openDeviceByIndex(const int index, const bool infrared, const char * recordFilename)
+{
+	const char * serial = getSerial(index);
+	
+	if (serial == nullptr)
+	{
+		logError("no camera found with index %d", index);
+		return nullptr;
+	}
+	
+	return openDevice(serial, infrared, recordFilename);
+}
+
+CclKinect * CclKinectManager::openReplay(const char * filename, const bool infrared)
+{
+	return open(std::string("replay:") + filename, nullptr, filename, infrared, nullptr);
+}
+
+CclKinect * CclKinectManager::open(const std::string & key, const char * serial, const char * replayFilename, const bool infrared, const char * recordFilename)
+{
+	CclKinect * result = nullptr;
+	
+	SDL_LockMutex(mutex);
+	{
+		for (auto & device : devices)
+		{
+			if (device.key == key)
+			{
+				if (device.kinect->bIsVideoInfrared != infrared)
+					logWarning("kinect %s is already in use with a different video mode", key.c_str());
+				if (recordFilename != nullptr && recordFilename[0] != 0 && device.kinect->recordFilename != recordFilename)
+					logWarning("kinect %s is already in use. not recording to %s", key.c_str(), recordFilename);
+				
+				device.refCount++;
+				
+				result = device.kinect;
+				break;
+			}
+		}
 		
-		std::swap(self->videoData[0], self->videoData[1]);
-		freenect_set_video_buffer(self->device, self->videoData[0]);
+		if (result == nullptr)
+		{
+			CclKinect * kinect = new CclKinect();
+			
+			if (serial != nullptr)
+				kinect->serial = serial;
+			if (replayFilename != nullptr)
+				kinect->replayFilename = replayFilename;
+			if (recordFilename != nullptr)
+				kinect->recordFilename = recordFilename;
+			
+			kinect->bIsVideoInfrared = infrared;
+			
+			if (kinect->init())
+			{
+				Device device;
+				device.key = key;
+				device.kinect = kinect;
+				device.refCount = 1;
+				
+				devices.push_back(device);
+				
+				result = kinect;
+			}
+			else
+			{
+				delete kinect;
+				kinect = nullptr;
+			}
+		}
+	}
+	SDL_UnlockMutex(mutex);
+	
+	return result;
+}
+
+void CclKinectManager::closeDevice(CclKinect * kinect)
+{
+	SDL_LockMutex(mutex);
+	{
+		for (auto i = devices.begin(); i != devices.end(); ++i)
+		{
+			if (i->kinect == kinect)
+			{
+				i->refCount--;
+				
+				// note : the device is shut down while holding the lock, so it's closed before anyone may open it again
+				
+				if (i->refCount == 0)
+				{
+					i->kinect->shut();
+					
+					delete i->kinect;
+					i->kinect = nullptr;
+					
+					devices.erase(i);
+				}
+				
+				break;
+			}
+		}
 	}
-	SDL_UnlockMutex(self->mutex);
+	SDL_UnlockMutex(mutex);
 }
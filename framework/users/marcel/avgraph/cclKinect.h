@@ -1,30 +1,194 @@
 #pragma once
 
+#include "cclDepthBlobs.h"
+#include "cclPointCloud.h"
 #include "libfreenect.h"
+#include "mappedFile.h"
+#include "vfxTripleBuffer.h"
 #include "Vec3.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
 
-struct SDL_mutex;
-struct SDL_Thread;
+enum CclKinectStream
+{
+	kCclKinectStream_Video,
+	kCclKinectStream_Depth,
+	kCclKinectStream_PointCloud,
+	kCclKinectStream_Blobs
+};
+
+struct CclKinectFrame
+{
+	void * data;
+	
+	uint32_t timestamp; // the timestamp given by the device, or the time in milliseconds for replayed frames
+	uint32_t sequence; // increments with every frame received from the device. gaps mean frames were skipped
+	
+	// the size of the grid of converted pixels, and the number of points, for point cloud frames
+	
+	int sx;
+	int sy;
+	int numPoints;
+};
+
+/*
+
+CclKinectConsumer receives the frames of one stream of a kinect. each consumer has a triple buffer of its own,
+so any number of consumers can use the same stream, without waiting for each other or taking frames away from
+each other. the frames are copied into the buffer of each consumer on the processing thread of the kinect.
+point clouds and blobs are computed per consumer, with the settings of the consumer.
+
+usage:
+	
+	CclKinectConsumer * consumer = kinect->addConsumer(kCclKinectStream_Depth);
+	
+	// consumer thread
+	
+	const CclKinectFrame * frame = consumer->acquireFrame();
+	
+	..
+	
+	kinect->removeConsumer(consumer);
+
+*/
+
+struct CclKinectConsumer
+{
+	CclKinectStream stream;
+	
+	CclKinectFrame frames[3];
+	VfxTripleBuffer exchange;
+	
+	// the point cloud settings are set by the consumer and picked up by the kinect thread. depths are in millimeters
+	
+	SDL_atomic_t pointCloudStride;
+	SDL_atomic_t pointCloudMinDepth;
+	SDL_atomic_t pointCloudMaxDepth;
+	
+	CclPointCloudConverter pointCloudConverter;
+	
+	// the blob settings are handed from the consumer to the kinect thread through a triple buffer of their own,
+	// with the consumer as the producer
+	
+	CclDepthBlobSettings blobSettings[3];
+	VfxTripleBuffer blobSettingsExchange;
+	
+	CclDepthBlobDetector * blobDetector;
+	
+	CclKinectConsumer(const CclKinectStream stream, const int dataSize);
+	~CclKinectConsumer();
+	
+	// returns the latest frame when a new frame arrived since the last call, and null otherwise. the frame stays
+	// valid until the next call. must be called from a single thread
+	
+	const CclKinectFrame * acquireFrame();
+	
+	// every stride'th pixel is converted, and points outside the depth range are skipped
+	
+	void setPointCloudSettings(const int stride, const int minDepth, const int maxDepth)
+	{
+		SDL_AtomicSet(&pointCloudMinDepth, minDepth);
+		SDL_AtomicSet(&pointCloudMaxDepth, maxDepth);
+		SDL_AtomicSet(&pointCloudStride, stride);
+	}
+	
+	// must be called from the thread acquiring the frames
+	
+	void setBlobSettings(const CclDepthBlobSettings & settings)
+	{
+		blobSettings[blobSettingsExchange.writeIndex] = settings;
+		
+		blobSettingsExchange.publish();
+	}
+	
+	// called on the processing thread, to fill the frame at the write index
+	
+	void convertPointCloud(const uint16_t * depth, const float referencePixelSize, const float referenceDistance, CclKinectFrame & frame);
+	void detectBlobs(const uint16_t * depth, CclKinectFrame & frame);
+	
+private:
+	CclKinectConsumer(const CclKinectConsumer & other);
+	CclKinectConsumer & operator=(const CclKinectConsumer & other);
+};
+
+/*
+
+CclKinect captures video and depth frames from a single kinect, on a thread of its own. each kinect has its own
+freenect context, so devices process their events independently, and a slow or stalled device doesn't hold up
+the others.
+
+instead of capturing from a device, frames can be replayed from a recording, for machines without a kinect.
+recordings consist of two files with raw frames, stored one after the other without a header. <name>.depth
+holds 640x480 16 bit depth values in millimeters. <name>.video holds 640x480 RGB pixels, or 640x488 8 bit
+pixels for infrared. setting recordFilename writes the captured frames in this format.
+
+the capture callbacks, which run on the kinect thread in between processing usb events, only copy the frames
+into a triple buffer per stream, and wake up the processing thread. the processing thread writes the recording
+and hands the latest frames to the consumers, see CclKinectConsumer. when processing can't keep up, frames are
+dropped, rather than holding up the kinect thread. the consumers are added and removed under a lock, which the
+processing thread takes only to make a copy of the list of consumers. removed consumers are deleted by the
+processing thread, once it's done with them. acquiring frames doesn't take the lock.
+
+*/
 
 struct CclKinect
 {
 	const static int width = 640;
 	const static int height = 480;
 	
+	const static int kReplayFrameRate = 30;
+	
 	freenect_context * context;
 	freenect_device * device;
 	
+	std::string serial; // the serial of the device to open. the first device found is opened when empty
+	std::string replayFilename; // replays frames from a recording instead of opening a device, when set
+	std::string recordFilename; // writes the captured frames to a recording, when set
+	
 	bool bIsVideoInfrared = false;
 	bool bUseRegistration = true;
 	
-	void * videoData[2];
-	void * depthData[2];
+	int videoDataSize;
+	int depthDataSize;
+	
+	// freenect captures into these buffers. frames are copied out from the capture callbacks, so a single
+	// buffer per stream is enough
+	
+	void * videoCaptureBuffer;
+	void * depthCaptureBuffer;
 	
-	bool hasVideo;
-	bool hasDepth;
+	// the raw frames, handed from the kinect thread to the processing thread
 	
-	void * video;
-	void * depth;
+	CclKinectFrame videoFrames[3];
+	VfxTripleBuffer videoExchange;
+	
+	CclKinectFrame depthFrames[3];
+	VfxTripleBuffer depthExchange;
+	
+	uint32_t nextVideoSequence;
+	uint32_t nextDepthSequence;
+	
+	SDL_sem * frameSemaphore; // posted when a frame is submitted, or when the processing thread should stop
+	
+	std::vector<CclKinectConsumer*> consumers; // protected by consumerMutex
+	std::vector<CclKinectConsumer*> retiredConsumers; // removed consumers, to be deleted by the processing thread. protected by consumerMutex
+	SDL_mutex * consumerMutex;
+	
+	std::vector<CclKinectConsumer*> processingConsumers; // the copy of consumers the processing thread works with
+	
+	// the zero plane info of the device, used to convert depth values into points. see libfreenect_registration.h
+	
+	float referencePixelSize;
+	float referenceDistance;
+	
+	MappedFile replayVideoFile;
+	MappedFile replayDepthFile;
+	uint32_t replayStartTime;
+	int replayFrameIndex;
+	
+	FILE * recordVideoFile;
+	FILE * recordDepthFile;
 	
 	freenect_led_options currentLed;
 	bool ledIsDirty;
@@ -36,39 +200,169 @@ struct CclKinect
 	Vec3 mksAccel;
 	Vec3 rawAccel;
 	
-	SDL_mutex * mutex;
 	SDL_Thread * thread;
-	bool stopThread;
+	SDL_atomic_t stopThread;
+	
+	SDL_Thread * processingThread;
+	SDL_atomic_t stopProcessingThread;
 	
 	CclKinect()
 		: context(nullptr)
 		, device(nullptr)
-		, videoData()
-		, depthData()
-		, hasVideo(false)
-		, hasDepth(false)
-		, video(nullptr)
-		, depth(nullptr)
+		, serial()
+		, replayFilename()
+		, recordFilename()
+		, videoDataSize(0)
+		, depthDataSize(0)
+		, videoCaptureBuffer(nullptr)
+		, depthCaptureBuffer(nullptr)
+		, videoFrames()
+		, videoExchange()
+		, depthFrames()
+		, depthExchange()
+		, nextVideoSequence(0)
+		, nextDepthSequence(0)
+		, frameSemaphore(nullptr)
+		, consumers()
+		, retiredConsumers()
+		, consumerMutex(nullptr)
+		, processingConsumers()
+		, referencePixelSize(0.1042f) // typical values, used for replays
+		, referenceDistance(120.f)
+		, replayVideoFile()
+		, replayDepthFile()
+		, replayStartTime(0)
+		, replayFrameIndex(0)
+		, recordVideoFile(nullptr)
+		, recordDepthFile(nullptr)
 		, currentLed(LED_GREEN)
 		, ledIsDirty(true)
 		, oldTiltAngle(0.f)
 		, newTiltAngle(0.f)
 		, tiltAngleIsDirty(true)
-		, mutex(nullptr)
 		, thread(nullptr)
-		, stopThread(false)
+		, processingThread(nullptr)
 	{
+		SDL_AtomicSet(&stopThread, 0);
+		SDL_AtomicSet(&stopProcessingThread, 0);
+		
+		consumerMutex = SDL_CreateMutex();
+		frameSemaphore = SDL_CreateSemaphore(0);
+	}
+	
+	~CclKinect()
+	{
+		shut();
+		
+		SDL_DestroySemaphore(frameSemaphore);
+		frameSemaphore = nullptr;
+		
+		SDL_DestroyMutex(consumerMutex);
+		consumerMutex = nullptr;
 	}
 	
 	bool init();
 	bool shut();
 	
+	bool isReplay() const
+	{
+		return !replayFilename.empty();
+	}
+	
+	// lists the serials of the connected devices
+	
+	static bool listDevices(std::vector<std::string> & serials);
+	
+	CclKinectConsumer * addConsumer(const CclKinectStream stream);
+	void removeConsumer(CclKinectConsumer * consumer);
+	
+	// called on the kinect thread, to hand a frame to the processing thread
+	
+	void submitVideoFrame(const void * data, const uint32_t timestamp);
+	void submitDepthFrame(const void * data, const uint32_t timestamp);
+	
+	// called on the processing thread, to hand a frame to the consumers
+	
+	void publishVideoFrame(const CclKinectFrame & rawFrame);
+	void publishDepthFrame(const CclKinectFrame & rawFrame);
+	
 	void threadInit();
 	void threadShut();
 	bool threadProcess();
+	bool threadProcessReplay();
 	
 	static int threadMain(void * userData);
 	
+	void processingThreadInit();
+	void processingThreadShut();
+	void processingThreadProcess();
+	
+	static int processingThreadMain(void * userData);
+	
 	static void grabDepthFrame(freenect_device * dev, void * depth, uint32_t timestamp);
 	static void grabVideoFrame(freenect_device * dev, void * video, uint32_t timestamp);
 };
+
+/*
+
+CclKinectManager opens kinects on behalf of the nodes using them. devices are shared by the nodes asking for
+the same serial or recording, and are closed when the last node using them lets go. devices are identified
+either by serial, or by index. indices refer to the configured serials when any are given, and to the
+connected devices in the order they are found otherwise. configuring serials keeps the indices stable
+between runs, on rigs with multiple kinects.
+
+usage:
+	
+	CclKinect * kinect = g_kinectManager.openDeviceByIndex(1, false, nullptr);
+	
+	if (kinect != nullptr)
+	{
+		CclKinectConsumer * consumer = kinect->addConsumer(kCclKinectStream_Depth);
+		
+		const CclKinectFrame * depthFrame = consumer->acquireFrame();
+		
+		..
+		
+		kinect->removeConsumer(consumer);
+		
+		g_kinectManager.closeDevice(kinect);
+	}
+
+*/
+
+struct CclKinectManager
+{
+	struct Device
+	{
+		std::string key;
+		CclKinect * kinect;
+		int refCount;
+	};
+	
+	std::vector<std::string> configuredSerials;
+	
+	std::vector<std::string> serials;
+	bool hasListedDevices;
+	
+	std::vector<Device> devices;
+	
+	SDL_mutex * mutex;
+	
+	CclKinectManager();
+	~CclKinectManager();
+	
+	// returns the serial of the device at index, or null when there is no such device
+	
+	const char * getSerial(const int index);
+	
+	CclKinect * openDevice(const char * serial, const bool infrared, const char * recordFilename);
+	CclKinect * openDeviceByIndex(const int index, const bool infrared, const char * recordFilename);
+	CclKinect * openReplay(const char * filename, const bool infrared);
+	
+	void closeDevice(CclKinect * kinect);
+	
+private:
+	CclKinect * open(const std::string & key, const char * serial, const char * replayFilename, const bool infrared, const char * recordFilename);
+};
+
+extern CclKinectManager g_kinectManager;
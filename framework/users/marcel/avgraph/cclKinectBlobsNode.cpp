@@ -0,0 +1,151 @@
+#include "cclKinect.h"
+#include "cclKinectBlobsNode.h"
+
+VfxNodeCclKinectBlobs::VfxNodeCclKinectBlobs()
+	: VfxNodeBase()
+	, maskImage()
+	, numBlobs(0)
+	, blobs()
+	, eventId()
+	, maskTexture()
+	, kinect(nullptr)
+	, consumer(nullptr)
+	, resetCount(0)
+{
+	resizeSockets(kInput_COUNT, kOutput_COUNT);
+	addInitInput(kInput_DeviceId, kVfxPlugType_Int);
+	addInitInput(kInput_Serial, kVfxPlugType_String);
+	addInitInput(kInput_ReplayFilename, kVfxPlugType_String);
+	addInput(kInput_Threshold, kVfxPlugType_Int);
+	addInput(kInput_MinDepth, kVfxPlugType_Int);
+	addInput(kInput_MaxDepth, kVfxPlugType_Int);
+	addInput(kInput_LearnRate, kVfxPlugType_Float);
+	addInput(kInput_MinArea, kVfxPlugType_Int);
+	addInput(kInput_ResetBackground, kVfxPlugType_Trigger);
+	addOutput(kOutput_Mask, kVfxPlugType_Image, &maskImage);
+	addOutput(kOutput_NumBlobs, kVfxPlugType_Int, &numBlobs);
+	addOutput(kOutput_Blobs, kVfxPlugType_FloatArray, &blobs);
+	addOutput(kOutput_Trigger, kVfxPlugType_Trigger, &eventId);
+}
+
+VfxNodeCclKinectBlobs::~VfxNodeCclKinectBlobs()
+{
+	if (kinect != nullptr)
+	{
+		if (consumer != nullptr)
+		{
+			kinect->removeConsumer(consumer);
+			consumer = nullptr;
+		}
+		
+		g_kinectManager.closeDevice(kinect);
+		kinect = nullptr;
+	}
+}
+
+void VfxNodeCclKinectBlobs::init(const GraphNode & node)
+{
+	const int deviceId = getInputInt(kInput_DeviceId, 0);
+	const char * serial = getInputString(kInput_Serial, "");
+	const char * replayFilename = getInputString(kInput_ReplayFilename, "");
+	
+	if (replayFilename[0] != 0)
+		kinect = g_kinectManager.openReplay(replayFilename, false);
+	else if (serial[0] != 0)
+		kinect = g_kinectManager.openDevice(serial, false, nullptr);
+	else
+		kinect = g_kinectManager.openDeviceByIndex(deviceId, false, nullptr);
+	
+	if (kinect != nullptr)
+	{
+		// note : each node has a background model of its own
+		
+		consumer = kinect->addConsumer(kCclKinectStream_Blobs);
+	}
+}
+
+void VfxNodeCclKinectBlobs::tick(const float dt)
+{
+	if (consumer == nullptr)
+	{
+		return;
+	}
+	
+	// note : blobs are detected on the kinect thread. settings changes apply from the next depth frame on
+	
+	CclDepthBlobSettings settings;
+	settings.threshold = getInputInt(kInput_Threshold, settings.threshold);
+	settings.minDepth = getInputInt(kInput_MinDepth, settings.minDepth);
+	settings.maxDepth = getInputInt(kInput_MaxDepth, settings.maxDepth);
+	settings.learnRate = getInputFloat(kInput_LearnRate, settings.learnRate);
+	settings.minArea = getInputInt(kInput_MinArea, settings.minArea);
+	settings.resetCount = resetCount;
+	
+	consumer->setBlobSettings(settings);
+	
+	const CclKinectFrame * frame = consumer->acquireFrame();
+	
+	if (frame == nullptr)
+	{
+		return;
+	}
+	
+	const CclDepthBlobs & detectedBlobs = *(const CclDepthBlobs*)frame->data;
+	
+	if (!maskTexture.isAllocated())
+	{
+		maskTexture.allocate(CclDepthBlobs::kWidth, CclDepthBlobs::kHeight, GL_R8, GL_RED, GL_UNSIGNED_BYTE, false, true);
+		maskTexture.setSwizzle(GL_RED, GL_RED, GL_RED, GL_ONE);
+		
+		maskImage.texture = maskTexture.texture;
+	}
+	
+	void * pixels = maskTexture.beginUpdate();
+	
+	if (pixels != nullptr)
+	{
+		memcpy(pixels, detectedBlobs.mask, maskTexture.getUpdateSize());
+		
+		maskTexture.endUpdate();
+	}
+	
+	//
+	
+	const float sx = 1.f / CclDepthBlobs::kWidth;
+	const float sy = 1.f / CclDepthBlobs::kHeight;
+	
+	float values[CclDepthBlobs::kMaxBlobs * kFloatsPerBlob];
+	
+	for (int i = 0; i < detectedBlobs.numBlobs; ++i)
+	{
+		const CclDepthBlob & blob = detectedBlobs.blobs[i];
+		
+		float * value = values + i * kFloatsPerBlob;
+		
+		value[0] = blob.id;
+		value[1] = blob.x * sx;
+		value[2] = blob.y * sy;
+		value[3] = blob.z;
+		value[4] = blob.area;
+		value[5] = blob.minX * sx;
+		value[6] = blob.minY * sy;
+		value[7] = blob.maxX * sx;
+		value[8] = blob.maxY * sy;
+	}
+	
+	numBlobs = detectedBlobs.numBlobs;
+	
+	blobs.set(values, detectedBlobs.numBlobs * kFloatsPerBlob);
+	
+	eventId.setFloatArray(&blobs);
+	
+	trigger(kOutput_Trigger);
+}
+
+void VfxNodeCclKinectBlobs::handleTrigger(int socketIndex)
+{
+	if (socketIndex == kInput_ResetBackground)
+	{
+		resetCount++;
+	}
+}
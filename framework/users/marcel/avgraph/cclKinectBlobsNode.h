@@ -0,0 +1,65 @@
+#pragma once
+
+#include "cclDepthBlobs.h"
+#include "vfxNodes/vfxNodeBase.h"
+#include "vfxStreamingTexture.h"
+
+struct CclKinect;
+struct CclKinectConsumer;
+
+// detects the blobs in front of the background of a kinect. outputs a mask image of the blobs, and a list with
+// kFloatsPerBlob values for each blob: id, centroid x, centroid y, mean depth (mm), area (pixels), min x, min y,
+// max x and max y. positions are relative to the size of the image, from 0 to 1. the trigger fires for each
+// new list of blobs
+
+struct VfxNodeCclKinectBlobs : VfxNodeBase
+{
+	static const int kFloatsPerBlob = 9;
+	
+	static_assert(CclDepthBlobs::kMaxBlobs * kFloatsPerBlob <= VfxFloatArray::kMaxElements, "the blob list must fit in a float array");
+	
+	enum Input
+	{
+		kInput_DeviceId,
+		kInput_Serial,
+		kInput_ReplayFilename,
+		kInput_Threshold,
+		kInput_MinDepth,
+		kInput_MaxDepth,
+		kInput_LearnRate,
+		kInput_MinArea,
+		kInput_ResetBackground,
+		kInput_COUNT
+	};
+	
+	enum Output
+	{
+		kOutput_Mask,
+		kOutput_NumBlobs,
+		kOutput_Blobs,
+		kOutput_Trigger,
+		kOutput_COUNT
+	};
+	
+	VfxImage_Texture maskImage;
+	int numBlobs;
+	VfxFloatArray blobs;
+	VfxTriggerData eventId;
+	
+	VfxStreamingTexture maskTexture;
+	
+	CclKinect * kinect;
+	
+	CclKinectConsumer * consumer;
+	
+	int resetCount;
+	
+	VfxNodeCclKinectBlobs();
+	virtual ~VfxNodeCclKinectBlobs() override;
+	
+	virtual void init(const GraphNode & node) override;
+	
+	virtual void tick(const float dt) override;
+	
+	virtual void handleTrigger(int socketIndex) override;
+};
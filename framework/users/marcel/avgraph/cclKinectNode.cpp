@@ -5,80 +5,130 @@ VfxNodeCclKinect::VfxNodeCclKinect()
 	: VfxNodeBase()
 	, videoImage()
 	, depthImage()
+	, videoTexture()
+	, depthTexture()
 	, kinect(nullptr)
+	, videoConsumer(nullptr)
+	, depthConsumer(nullptr)
 {
 	resizeSockets(kInput_COUNT, kOutput_COUNT);
-	addInput(kInput_DeviceId, kVfxPlugType_Int);
-	addInput(kInput_Infrared, kVfxPlugType_Bool);
+	addInitInput(kInput_DeviceId, kVfxPlugType_Int);
+	addInitInput(kInput_Infrared, kVfxPlugType_Bool);
+	addInitInput(kInput_Serial, kVfxPlugType_String);
+	addInitInput(kInput_ReplayFilename, kVfxPlugType_String);
+	addInitInput(kInput_RecordFilename, kVfxPlugType_String);
 	addOutput(kOutput_VideoImage, kVfxPlugType_Image, &videoImage);
 	addOutput(kOutput_DepthImage, kVfxPlugType_Image, &depthImage);
 }
 
 VfxNodeCclKinect::~VfxNodeCclKinect()
 {
-	kinect->shut();
-
-	delete kinect;
-	kinect = nullptr;	
+	if (kinect != nullptr)
+	{
+		if (videoConsumer != nullptr)
+		{
+			kinect->removeConsumer(videoConsumer);
+			videoConsumer = nullptr;
+		}
+		
+		if (depthConsumer != nullptr)
+		{
+			kinect->removeConsumer(depthConsumer);
+			depthConsumer = nullptr;
+		}
+		
+		g_kinectManager.closeDevice(kinect);
+		kinect = nullptr;
+	}
 }
 
 void VfxNodeCclKinect::init(const GraphNode & node)
 {
+	const int deviceId = getInputInt(kInput_DeviceId, 0);
 	const bool videoIsInfrared = getInputBool(kInput_Infrared, false);
+	const char * serial = getInputString(kInput_Serial, "");
+	const char * replayFilename = getInputString(kInput_ReplayFilename, "");
+	const char * recordFilename = getInputString(kInput_RecordFilename, "");
 	
-	kinect = new CclKinect();
-	kinect->bIsVideoInfrared = videoIsInfrared;
+	// the device is either a recording, the device with the given serial, or the device at the given index
 	
-	kinect->init();
+	if (replayFilename[0] != 0)
+		kinect = g_kinectManager.openReplay(replayFilename, videoIsInfrared);
+	else if (serial[0] != 0)
+		kinect = g_kinectManager.openDevice(serial, videoIsInfrared, recordFilename);
+	else
+		kinect = g_kinectManager.openDeviceByIndex(deviceId, videoIsInfrared, recordFilename);
+	
+	if (kinect != nullptr)
+	{
+		// note : every node gets its own copy of each frame, so multiple nodes can share the same device
+		
+		videoConsumer = kinect->addConsumer(kCclKinectStream_Video);
+		depthConsumer = kinect->addConsumer(kCclKinectStream_Depth);
+	}
 }
 
 void VfxNodeCclKinect::tick(const float dt)
 {
-	SDL_LockMutex(kinect->mutex);
+	if (kinect == nullptr)
+	{
+		return;
+	}
+	
+	// the textures are allocated once, and updated in place for each new frame
+	
+	if (!videoTexture.isAllocated())
 	{
-		if (kinect->hasVideo)
+		if (kinect->bIsVideoInfrared)
 		{
-			kinect->hasVideo = false;
-			
-			// create texture from video data
-			
-			if (videoImage.texture != 0)
-			{
-				glDeleteTextures(1, &videoImage.texture);
-			}
-			
-			if (kinect->bIsVideoInfrared)
-			{
-				videoImage.texture = createTextureFromR8(kinect->video, kinect->width, kinect->height, true, true);
-				
-				glBindTexture(GL_TEXTURE_2D, videoImage.texture);
-				GLint swizzleMask[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
-				glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
-			}
-			else
-				videoImage.texture = createTextureFromRGB8(kinect->video, kinect->width, kinect->height, true, true);
+			videoTexture.allocate(kinect->width, kinect->height, GL_R8, GL_RED, GL_UNSIGNED_BYTE, true, true);
+			videoTexture.setSwizzle(GL_RED, GL_RED, GL_RED, GL_ONE);
+		}
+		else
+		{
+			videoTexture.allocate(kinect->width, kinect->height, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, true, true);
 		}
 		
-		if (kinect->hasDepth)
+		videoImage.texture = videoTexture.texture;
+	}
+	
+	if (!depthTexture.isAllocated())
+	{
+		// FREENECT_DEPTH_MM_MAX_VALUE
+		// FREENECT_DEPTH_MM_NO_VALUE
+		
+		depthTexture.allocate(kinect->width, kinect->height, GL_R16, GL_RED, GL_UNSIGNED_SHORT, true, true);
+		depthTexture.setSwizzle(GL_RED, GL_RED, GL_RED, GL_ONE);
+		
+		depthImage.texture = depthTexture.texture;
+	}
+	
+	// note : acquiring a frame never blocks the kinect thread. the frame stays ours until the next time we acquire one
+	
+	const CclKinectFrame * videoFrame = videoConsumer->acquireFrame();
+	const CclKinectFrame * depthFrame = depthConsumer->acquireFrame();
+	
+	if (videoFrame != nullptr)
+	{
+		void * pixels = videoTexture.beginUpdate();
+		
+		if (pixels != nullptr)
 		{
-			kinect->hasDepth = false;
-			
-			// FREENECT_DEPTH_MM_MAX_VALUE
-			// FREENECT_DEPTH_MM_NO_VALUE
-			
-			// create texture from depth data
+			memcpy(pixels, videoFrame->data, videoTexture.getUpdateSize());
 			
-			if (depthImage.texture != 0)
-			{
-				glDeleteTextures(1, &depthImage.texture);
-			}
-			
-			depthImage.texture = createTextureFromR16(kinect->depth, kinect->width, kinect->height, true, true);
+			videoTexture.endUpdate();
+		}
+	}
+	
+	if (depthFrame != nullptr)
+	{
+		void * pixels = depthTexture.beginUpdate();
+		
+		if (pixels != nullptr)
+		{
+			memcpy(pixels, depthFrame->data, depthTexture.getUpdateSize());
 			
-			glBindTexture(GL_TEXTURE_2D, depthImage.texture);
-			GLint swizzleMask[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
-			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
+			depthTexture.endUpdate();
 		}
 	}
-	SDL_UnlockMutex(kinect->mutex);
 }
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "vfxNodes/vfxNodeBase.h"
+#include "vfxStreamingTexture.h"
 
 struct CclKinect;
+struct CclKinectConsumer;
 
 struct VfxNodeCclKinect : VfxNodeBase
 {
@@ -10,6 +12,9 @@ struct VfxNodeCclKinect : VfxNodeBase
 	{
 		kInput_DeviceId,
 		kInput_Infrared,
+		kInput_Serial,
+		kInput_ReplayFilename,
+		kInput_RecordFilename,
 		kInput_COUNT
 	};
 	
@@ -23,7 +28,13 @@ struct VfxNodeCclKinect : VfxNodeBase
 	VfxImage_Texture videoImage;
 	VfxImage_Texture depthImage;
 	
+	VfxStreamingTexture videoTexture;
+	VfxStreamingTexture depthTexture;
+	
 	CclKinect * kinect;
+	
+	CclKinectConsumer * videoConsumer;
+	CclKinectConsumer * depthConsumer;
 
 	VfxNodeCclKinect();
 	virtual ~VfxNodeCclKinect() override;
@@ -0,0 +1,99 @@
+#include "cclKinect.h"
+#include "cclKinectPointCloudNode.h"
+
+VfxNodeCclKinectPointCloud::VfxNodeCclKinectPointCloud()
+	: VfxNodeBase()
+	, image()
+	, numPoints(0)
+	, texture()
+	, kinect(nullptr)
+	, consumer(nullptr)
+{
+	resizeSockets(kInput_COUNT, kOutput_COUNT);
+	addInitInput(kInput_DeviceId, kVfxPlugType_Int);
+	addInitInput(kInput_Serial, kVfxPlugType_String);
+	addInitInput(kInput_ReplayFilename, kVfxPlugType_String);
+	addInput(kInput_Stride, kVfxPlugType_Int);
+	addInput(kInput_MinDepth, kVfxPlugType_Int);
+	addInput(kInput_MaxDepth, kVfxPlugType_Int);
+	addOutput(kOutput_Image, kVfxPlugType_Image, &image);
+	addOutput(kOutput_NumPoints, kVfxPlugType_Int, &numPoints);
+}
+
+VfxNodeCclKinectPointCloud::~VfxNodeCclKinectPointCloud()
+{
+	if (kinect != nullptr)
+	{
+		if (consumer != nullptr)
+		{
+			kinect->removeConsumer(consumer);
+			consumer = nullptr;
+		}
+		
+		g_kinectManager.closeDevice(kinect);
+		kinect = nullptr;
+	}
+}
+
+void VfxNodeCclKinectPointCloud::init(const GraphNode & node)
+{
+	const int deviceId = getInputInt(kInput_DeviceId, 0);
+	const char * serial = getInputString(kInput_Serial, "");
+	const char * replayFilename = getInputString(kInput_ReplayFilename, "");
+	
+	if (replayFilename[0] != 0)
+		kinect = g_kinectManager.openReplay(replayFilename, false);
+	else if (serial[0] != 0)
+		kinect = g_kinectManager.openDevice(serial, false, nullptr);
+	else
+		kinect = g_kinectManager.openDeviceByIndex(deviceId, false, nullptr);
+	
+	if (kinect != nullptr)
+	{
+		consumer = kinect->addConsumer(kCclKinectStream_PointCloud);
+	}
+}
+
+void VfxNodeCclKinectPointCloud::tick(const float dt)
+{
+	if (consumer == nullptr)
+	{
+		return;
+	}
+	
+	// note : the point cloud is converted on the kinect thread. settings changes apply from the next depth frame on
+	
+	const int stride = std::max(1, getInputInt(kInput_Stride, 1));
+	const int minDepth = getInputInt(kInput_MinDepth, 0);
+	const int maxDepth = getInputInt(kInput_MaxDepth, 10000);
+	
+	consumer->setPointCloudSettings(stride, minDepth, maxDepth);
+	
+	const CclKinectFrame * frame = consumer->acquireFrame();
+	
+	if (frame == nullptr)
+	{
+		return;
+	}
+	
+	if (texture.sx != frame->sx || texture.sy != frame->sy || !texture.isAllocated())
+	{
+		texture.allocate(frame->sx, frame->sy, GL_RGB32F, GL_RGB, GL_FLOAT, false, true);
+		
+		image.texture = texture.texture;
+	}
+	
+	uint8_t * pixels = (uint8_t*)texture.beginUpdate();
+	
+	if (pixels != nullptr)
+	{
+		const int numBytes = frame->numPoints * 3 * sizeof(float);
+		
+		memcpy(pixels, frame->data, numBytes);
+		memset(pixels + numBytes, 0, texture.getUpdateSize() - numBytes);
+		
+		texture.endUpdate();
+	}
+	
+	numPoints = frame->numPoints;
+}
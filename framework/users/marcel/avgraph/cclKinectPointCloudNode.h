@@ -0,0 +1,47 @@
+#pragma once
+
+#include "vfxNodes/vfxNodeBase.h"
+#include "vfxStreamingTexture.h"
+
+struct CclKinect;
+struct CclKinectConsumer;
+
+// outputs the point cloud of a kinect as an RGB32F image. the points are packed together from the start of the
+// image, in row order, and the texels past the last point are zero
+
+struct VfxNodeCclKinectPointCloud : VfxNodeBase
+{
+	enum Input
+	{
+		kInput_DeviceId,
+		kInput_Serial,
+		kInput_ReplayFilename,
+		kInput_Stride,
+		kInput_MinDepth,
+		kInput_MaxDepth,
+		kInput_COUNT
+	};
+	
+	enum Output
+	{
+		kOutput_Image,
+		kOutput_NumPoints,
+		kOutput_COUNT
+	};
+	
+	VfxImage_Texture image;
+	int numPoints;
+	
+	VfxStreamingTexture texture;
+	
+	CclKinect * kinect;
+	
+	CclKinectConsumer * consumer;
+	
+	VfxNodeCclKinectPointCloud();
+	virtual ~VfxNodeCclKinectPointCloud() override;
+	
+	virtual void init(const GraphNode & node) override;
+	
+	virtual void tick(const float dt) override;
+};
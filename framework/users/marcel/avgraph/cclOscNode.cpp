@@ -1,48 +1,71 @@
 #include "cclOscNode.h"
+#include "oscRouteTable.h"
+#include "vfxMessageRing.h"
 
 #include "ip/UdpSocket.h"
 #include "osc/OscOutboundPacketStream.h"
 #include "osc/OscPacketListener.h"
+#include <stdlib.h>
 
-#include "StringEx.h"
+enum CclOscRoute
+{
+	kCclOscRoute_Joints,
+	kCclOscRoute_K2Joints,
+	kCclOscRoute_BodyJoints, // /joints/<body index>, sent by kinect2osc when sending all bodies
+	kCclOscRoute_COUNT
+};
 
-#include <list>
+static const int kCclOscMaxBodies = 6;
 
 struct CclOscMessage
 {
 	static const int kNumFloats = 75;
 	
 	CclOscMessage()
-		: event()
-		, values()
+		: routeId(OscRouteTable::kInvalidRouteId)
+		, bodyIndex(0)
 		, numValues(0)
 	{
 		memset(values, 0, sizeof(values));
 	}
 	
-	std::string event;
-	std::string str;
+	int routeId;
+	int bodyIndex;
 	float values[kNumFloats];
 	int numValues;
 };
 
-class MyOscPacketListener : public osc::OscPacketListener
+class CclOscPacketListener : public RoutingOscPacketListener<CclOscPacketListener>
 {
 public:
-	SDL_mutex * oscMessageMtx;
-	std::list<CclOscMessage> oscMessages;
+	static const int kMaxMessages = 64;
 	
-	MyOscPacketListener()
-		: oscMessageMtx(nullptr)
-		, oscMessages()
-	{
-		oscMessageMtx = SDL_CreateMutex();
-	}
+	VfxMessageRing<CclOscMessage, kMaxMessages> oscMessages;
+	
+	// the latest message for each route, collected by the consumer while draining the ring
+	
+	CclOscMessage latestMessages[kCclOscRoute_COUNT];
+	bool hasLatestMessage[kCclOscRoute_COUNT];
 	
-	~MyOscPacketListener()
+	// the latest message for each body, for messages sent per body
+	
+	CclOscMessage latestBodyMessages[kCclOscMaxBodies];
+	bool hasLatestBodyMessage[kCclOscMaxBodies];
+	
+	int numCoalesced;
+	int numDroppedReported;
+	
+	CclOscPacketListener()
+		: oscMessages()
+		, numCoalesced(0)
+		, numDroppedReported(0)
 	{
-		SDL_DestroyMutex(oscMessageMtx);
-		oscMessageMtx = nullptr;
+		memset(hasLatestMessage, 0, sizeof(hasLatestMessage));
+		memset(hasLatestBodyMessage, 0, sizeof(hasLatestBodyMessage));
+		
+		RegisterRoute("/joints", kCclOscRoute_Joints, &CclOscPacketListener::handleJoints);
+		RegisterRoute("/k2/joints/xyz", kCclOscRoute_K2Joints, &CclOscPacketListener::handleJoints);
+		RegisterRoute("/joints/*", kCclOscRoute_BodyJoints, &CclOscPacketListener::handleJoints);
 	}
 	
 protected:
@@ -52,40 +75,92 @@ protected:
 
 		osc::OscPacketListener::ProcessBundle(b, remoteEndpoint);
 	}
-
-	virtual void ProcessMessage(const osc::ReceivedMessage & m, const IpEndpointName & remoteEndpoint) override
+	
+	virtual void ProcessUnroutedMessage(const osc::ReceivedMessage & m, const IpEndpointName & remoteEndpoint) override
+	{
+		logWarning("unknown message type: %s", m.AddressPattern());
+	}
+	
+	static int parseBodyIndex(const char * address)
+	{
+		const char * segment = strrchr(address, '/') + 1;
+		
+		char * end = nullptr;
+		const long bodyIndex = strtol(segment, &end, 10);
+		
+		if (end == segment || *end != 0 || bodyIndex < 0 || bodyIndex >= kCclOscMaxBodies)
+			return -1;
+		else
+			return int(bodyIndex);
+	}
+	
+	static float readBigEndianFloat(const uint8_t * bytes)
+	{
+		const uint32_t bits =
+			(uint32_t(bytes[0]) << 24) |
+			(uint32_t(bytes[1]) << 16) |
+			(uint32_t(bytes[2]) <<  8) |
+			(uint32_t(bytes[3]) <<  0);
+		
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		
+		return value;
+	}
+	
+	void handleJoints(const osc::ReceivedMessage & m, const int routeId, const IpEndpointName & remoteEndpoint)
 	{
 		try
 		{
-			//logDebug("ProcessMessage");
-
-			osc::ReceivedMessageArgumentStream args = m.ArgumentStream();
-
-			CclOscMessage message;
-
-			//if (strcmp(m.AddressPattern(), "/k2/joints/xyz") == 0)
-			if (true)
+			int bodyIndex = 0;
+			
+			if (routeId == kCclOscRoute_BodyJoints)
 			{
-				message.event = m.AddressPattern();
-				message.str = std::string(m.AddressPattern()).substr(1);
+				bodyIndex = parseBodyIndex(m.AddressPattern());
 				
-				for (int i = 0; i < CclOscMessage::kNumFloats; ++i)
-					args >> message.values[i];
-			}
-			else
-			{
-				logWarning("unknown message type: %s", m.AddressPattern());
+				if (bodyIndex < 0)
+				{
+					logWarning("invalid body index: %s", m.AddressPattern());
+					return;
+				}
 			}
-
-			if (!message.event.empty())
+			
+			CclOscMessage * message = oscMessages.beginPush();
+			
+			if (message != nullptr)
 			{
-				SDL_LockMutex(oscMessageMtx);
+				// note : when parsing fails the slot isn't published, and is reused for the next message
+				
+				message->routeId = routeId;
+				message->bodyIndex = bodyIndex;
+				
+				if (m.ArgumentCount() == 1 && m.ArgumentsBegin()->IsBlob())
 				{
-					//logDebug("enqueue OSC message. event=%s", message.event.c_str());
-
-					oscMessages.push_back(message);
+					// the values are sent as a single blob of big endian floats, when kinect2osc has blobs enabled
+					
+					const void * data = nullptr;
+					osc::osc_bundle_element_size_t size = 0;
+					
+					m.ArgumentsBegin()->AsBlob(data, size);
+					
+					const int numValues = std::min(int(size / 4), CclOscMessage::kNumFloats);
+					
+					for (int i = 0; i < numValues; ++i)
+						message->values[i] = readBigEndianFloat((const uint8_t*)data + i * 4);
+					
+					message->numValues = numValues;
 				}
-				SDL_UnlockMutex(oscMessageMtx);
+				else
+				{
+					osc::ReceivedMessageArgumentStream args = m.ArgumentStream();
+					
+					for (int i = 0; i < CclOscMessage::kNumFloats; ++i)
+						args >> message->values[i];
+					
+					message->numValues = CclOscMessage::kNumFloats;
+				}
+				
+				oscMessages.endPush();
 			}
 		}
 		catch (osc::Exception & e)
@@ -104,10 +179,10 @@ VfxNodeCclOsc::VfxNodeCclOsc()
 	, outputValues()
 {
 	resizeSockets(kInput_COUNT, kOutput_COUNT);
-	addInput(kInput_Port, kVfxPlugType_Int);
-	addInput(kInput_IpAddress, kVfxPlugType_String);
+	addInitInput(kInput_Port, kVfxPlugType_Int);
+	addInitInput(kInput_IpAddress, kVfxPlugType_String);
 	addOutput(kOutput_Trigger, kVfxPlugType_Trigger, &eventId);
-	addOutput(kOutput_Values, kVfxPlugType_String, &outputValues);
+	addOutput(kOutput_Values, kVfxPlugType_FloatArray, &outputValues);
 }
 
 VfxNodeCclOsc::~VfxNodeCclOsc()
@@ -144,7 +219,7 @@ void VfxNodeCclOsc::init(const GraphNode & node)
 	{
 		// create OSC client and listen
 		
-		oscPacketListener = new MyOscPacketListener();
+		oscPacketListener = new CclOscPacketListener();
 		
 		const std::string ipAddress = getInputString(kInput_IpAddress, "");
 		const int udpPort = getInputInt(kInput_Port, 0);
@@ -161,6 +236,10 @@ void VfxNodeCclOsc::init(const GraphNode & node)
 			
 			oscReceiveSocket = new UdpListeningReceiveSocket(IpEndpointName(ipAddress.c_str(), udpPort), oscPacketListener);
 			
+			// note : several Kinect rigs may send joint data at a high rate. use a large receive buffer so bursts don't overflow it
+			
+			oscReceiveSocket->SetReceiveBufferSize(4 * 1024 * 1024);
+			
 			logDebug("creating OSC receive thread");
 		
 			oscMessageThread = SDL_CreateThread(executeOscThread, "OSC thread", this);
@@ -174,33 +253,85 @@ void VfxNodeCclOsc::init(const GraphNode & node)
 
 void VfxNodeCclOsc::tick(const float dt)
 {
-	// update network input
-
-	SDL_LockMutex(oscPacketListener->oscMessageMtx);
+	// update network input. the CCL node only uses the most recent values for each route, so
+	// messages which arrived since the last tick are coalesced to the latest one for their route
+	
+	CclOscPacketListener & listener = *oscPacketListener;
+	
+	CclOscMessage message;
+	
+	while (listener.oscMessages.pop(message))
 	{
-		while (!oscPacketListener->oscMessages.empty())
+		if (message.routeId == kCclOscRoute_BodyJoints)
 		{
-			const CclOscMessage message = oscPacketListener->oscMessages.front();
+			if (listener.hasLatestBodyMessage[message.bodyIndex])
+				listener.numCoalesced++;
 			
-			oscPacketListener->oscMessages.pop_front();
+			listener.latestBodyMessages[message.bodyIndex] = message;
+			listener.hasLatestBodyMessage[message.bodyIndex] = true;
+		}
+		else
+		{
+			if (listener.hasLatestMessage[message.routeId])
+				listener.numCoalesced++;
 			
-			SDL_UnlockMutex(oscPacketListener->oscMessageMtx);
-			{
-				// todo : store OSC values in trigger mem
-				
-				outputValues.clear();
-				
-				for (int i = 0; i < message.kNumFloats; ++i)
-				{
-					outputValues = outputValues + "," + String::FormatC("%f", message.values[i]);
-				}
-				
-				trigger(kOutput_Trigger);
-			}
-			SDL_LockMutex(oscPacketListener->oscMessageMtx);
+			listener.latestMessages[message.routeId] = message;
+			listener.hasLatestMessage[message.routeId] = true;
 		}
 	}
-	SDL_UnlockMutex(oscPacketListener->oscMessageMtx);
+	
+	for (int i = 0; i < kCclOscRoute_COUNT; ++i)
+	{
+		if (listener.hasLatestMessage[i] == false)
+			continue;
+		
+		const CclOscMessage & latestMessage = listener.latestMessages[i];
+		
+		outputValues.set(latestMessage.values, latestMessage.numValues);
+		
+		eventId.setFloatArray(&outputValues);
+		
+		trigger(kOutput_Trigger);
+		
+		listener.hasLatestMessage[i] = false;
+	}
+	
+	// bodies sent separately are concatenated, so the joints of all bodies which arrived since the last tick
+	// are output at once, ordered by body index
+	
+	float bodyValues[kCclOscMaxBodies * CclOscMessage::kNumFloats];
+	int numBodyValues = 0;
+	
+	for (int i = 0; i < kCclOscMaxBodies; ++i)
+	{
+		if (listener.hasLatestBodyMessage[i] == false)
+			continue;
+		
+		const CclOscMessage & latestMessage = listener.latestBodyMessages[i];
+		
+		memcpy(bodyValues + numBodyValues, latestMessage.values, latestMessage.numValues * sizeof(float));
+		numBodyValues += latestMessage.numValues;
+		
+		listener.hasLatestBodyMessage[i] = false;
+	}
+	
+	if (numBodyValues > 0)
+	{
+		outputValues.set(bodyValues, numBodyValues);
+		
+		eventId.setFloatArray(&outputValues);
+		
+		trigger(kOutput_Trigger);
+	}
+	
+	const int numDropped = listener.oscMessages.getNumDropped();
+	
+	if (numDropped != listener.numDroppedReported)
+	{
+		logWarning("OSC message queue overflow. dropped %d messages in total", numDropped);
+		
+		listener.numDroppedReported = numDropped;
+	}
 }
 
 int VfxNodeCclOsc::executeOscThread(void * data)
@@ -2,7 +2,7 @@
 
 #include "vfxNodes/vfxNodeBase.h"
 
-class MyOscPacketListener;
+class CclOscPacketListener;
 class UdpListeningReceiveSocket;
 
 struct SDL_Thread;
@@ -25,12 +25,12 @@ struct VfxNodeCclOsc : VfxNodeBase
 	
 	VfxTriggerData eventId;
 	
-	MyOscPacketListener * oscPacketListener;
+	CclOscPacketListener * oscPacketListener;
 	UdpListeningReceiveSocket * oscReceiveSocket;
 	
 	SDL_Thread * oscMessageThread;
 	
-	std::string outputValues;
+	VfxFloatArray outputValues;
 	
 	VfxNodeCclOsc();
 	virtual ~VfxNodeCclOsc() override;
@@ -0,0 +1,151 @@
+#include "cclPointCloud.h"
+#include "framework.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CCL_USE_SSE 1
+	#include <emmintrin.h>
+#else
+	#define CCL_USE_SSE 0
+#endif
+
+CclPointCloudConverter::CclPointCloudConverter()
+	: referencePixelSize(0.f)
+	, referenceDistance(0.f)
+	, stride(0)
+	, sx(0)
+	, sy(0)
+	, rayX()
+	, rayY()
+{
+}
+
+void CclPointCloudConverter::init(const float _referencePixelSize, const float _referenceDistance, const int _stride)
+{
+	Assert(_referenceDistance > 0.f);
+	Assert(_stride >= 1);
+	
+	referencePixelSize = _referencePixelSize;
+	referenceDistance = _referenceDistance;
+	stride = _stride;
+	
+	sx = (kWidth + stride - 1) / stride;
+	sy = (kHeight + stride - 1) / stride;
+	
+	// note : the reference pixel size is given for the full 1280x1024 sensor. the 640x480 image is the sensor
+	//        image cropped to 1280x960 and scaled by one half, so pixels are twice the reference pixel size
+	
+	const double factor = 2.0 * referencePixelSize / referenceDistance;
+	
+	for (int x = 0; x < sx; ++x)
+		rayX[x] = float((x * stride - kWidth / 2) * factor);
+	
+	for (int y = 0; y < sy; ++y)
+		rayY[y] = float((y * stride - kHeight / 2) * factor);
+}
+
+int CclPointCloudConverter::convert(const uint16_t * depth, const int _minDepth, const int maxDepth, float * points) const
+{
+	Assert(isInitialized());
+	
+	// note : pixels without depth have a depth of zero, and are skipped along with the points closer than minDepth
+	
+	const int minDepth = _minDepth < 1 ? 1 : _minDepth;
+	
+	int numPoints = 0;
+	
+	for (int y = 0; y < sy; ++y)
+	{
+		const uint16_t * __restrict depthLine = depth + y * stride * kWidth;
+		
+		const float rayYValue = rayY[y];
+		
+		int x = 0;
+		
+	#if CCL_USE_SSE
+		const __m128i minDepth4 = _mm_set1_epi32(minDepth - 1);
+		const __m128i maxDepth4 = _mm_set1_epi32(maxDepth + 1);
+		const __m128 rayY4 = _mm_set1_ps(rayYValue);
+		
+		for (; x + 4 <= sx; x += 4)
+		{
+			__m128i d;
+			
+			if (stride == 1)
+				d = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(depthLine + x)), _mm_setzero_si128());
+			else
+				d = _mm_setr_epi32(depthLine[(x + 0) * stride], depthLine[(x + 1) * stride], depthLine[(x + 2) * stride], depthLine[(x + 3) * stride]);
+			
+			const int validBits = _mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(d, minDepth4), _mm_cmplt_epi32(d, maxDepth4))));
+			
+			if (validBits == 0)
+				continue;
+			
+			const __m128 z = _mm_cvtepi32_ps(d);
+			
+			// transpose the four points into three vectors holding x0 y0 z0 x1, y1 z1 x2 y2 and z2 x3 y3 z3
+			
+			const __m128 px = _mm_mul_ps(_mm_loadu_ps(rayX + x), z);
+			const __m128 py = _mm_mul_ps(rayY4, z);
+			
+			const __m128 xy01 = _mm_unpacklo_ps(px, py); // x0 y0 x1 y1
+			const __m128 xy23 = _mm_unpackhi_ps(px, py); // x2 y2 x3 y3
+			
+			const __m128 p0 = _mm_shuffle_ps(xy01, _mm_shuffle_ps(z, xy01, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+			const __m128 p1 = _mm_shuffle_ps(_mm_shuffle_ps(xy01, z, _MM_SHUFFLE(1, 1, 3, 3)), xy23, _MM_SHUFFLE(1, 0, 2, 0));
+			const __m128 p2 = _mm_shuffle_ps(_mm_shuffle_ps(z, xy23, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(xy23, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+			
+			if (validBits == 0xf)
+			{
+				float * __restrict dst = points + numPoints * 3;
+				
+				_mm_storeu_ps(dst + 0, p0);
+				_mm_storeu_ps(dst + 4, p1);
+				_mm_storeu_ps(dst + 8, p2);
+				
+				numPoints += 4;
+			}
+			else
+			{
+				// pack the valid points. every point is written, but only valid points advance the write position
+				
+				float p[12];
+				
+				_mm_storeu_ps(p + 0, p0);
+				_mm_storeu_ps(p + 4, p1);
+				_mm_storeu_ps(p + 8, p2);
+				
+				for (int i = 0; i < 4; ++i)
+				{
+					float * __restrict dst = points + numPoints * 3;
+					
+					dst[0] = p[i * 3 + 0];
+					dst[1] = p[i * 3 + 1];
+					dst[2] = p[i * 3 + 2];
+					
+					numPoints += (validBits >> i) & 1;
+				}
+			}
+		}
+	#endif
+		
+		for (; x < sx; ++x)
+		{
+			const int d = depthLine[x * stride];
+			
+			if (d >= minDepth && d <= maxDepth)
+			{
+				const float z = d;
+				
+				float * __restrict dst = points + numPoints * 3;
+				
+				dst[0] = rayX[x] * z;
+				dst[1] = rayYValue * z;
+				dst[2] = z;
+				
+				numPoints++;
+			}
+		}
+	}
+	
+	return numPoints;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+
+CclPointCloudConverter turns kinect depth frames into point clouds, converting a whole frame in one pass. the
+conversion is the same as freenect_camera_to_world, except the ray through each pixel is looked up from tables
+computed ahead of time from the device's zero plane info, instead of being computed per pixel in double
+precision. the camera model has no lens distortion, so the x component of a ray only depends on the column of
+the pixel, and the y component only on its row. the tables are kept per column and per row, and fit in L1.
+
+points are in millimeters, with x pointing right, y pointing down and z pointing away from the camera. every
+stride'th pixel is converted, in both directions. pixels without depth, or outside the depth range, are
+skipped, and the remaining points are packed together, three floats per point.
+
+usage:
+	
+	CclPointCloudConverter converter;
+	
+	converter.init(referencePixelSize, referenceDistance, 2);
+	
+	float * points = new float[converter.getMaxPoints() * 3];
+	
+	const int numPoints = converter.convert((const uint16_t*)depthFrame->data, 500, 4000, points);
+
+*/
+
+struct CclPointCloudConverter
+{
+	static const int kWidth = 640;
+	static const int kHeight = 480;
+	
+	float referencePixelSize;
+	float referenceDistance;
+	int stride;
+	
+	// the size of the grid of pixels which are converted
+	
+	int sx;
+	int sy;
+	
+	float rayX[kWidth];
+	float rayY[kHeight];
+	
+	CclPointCloudConverter();
+	
+	void init(const float referencePixelSize, const float referenceDistance, const int stride);
+	
+	bool isInitialized() const
+	{
+		return stride != 0;
+	}
+	
+	int getMaxPoints() const
+	{
+		return sx * sy;
+	}
+	
+	// converts a 640x480 frame of depth values in millimeters. returns the number of points written
+	
+	int convert(const uint16_t * depth, const int minDepth, const int maxDepth, float * points) const;
+};
@@ -7,6 +7,7 @@
 #include "../avpaint/video.h"
 
 #include "vfxGraph.h"
+#include "vfxScheduler.h"
 #include "vfxTypes.h"
 
 #include "vfxNodes/vfxNodeBase.h"
@@ -32,7 +33,10 @@
 #include "../libparticle/ui.h"
 
 #include "ccl.h"
+#include "cclKinect.h"
+#include "cclKinectBlobsNode.h"
 #include "cclKinectNode.h"
+#include "cclKinectPointCloudNode.h"
 #include "cclOscNode.h"
 
 using namespace tinyxml2;
@@ -533,39 +537,42 @@ struct VfxNodeImpulseResponse : VfxNodeBase
 
 static VfxNodeBase * createVfxNode(const GraphNodeId nodeId, const std::string & typeName, VfxGraph * vfxGraph)
 {
+	// note : nodes are allocated from the graph's arena. use VfxGraph::destroyNode to destroy them
+	
 	VfxNodeBase * vfxNode = nullptr;
 	
 #define DefineNodeImpl(_typeName, _type) \
 	else if (typeName == _typeName) \
-		vfxNode = new _type();
+		vfxNode = vfxGraph->arena.constructUntracked<_type>();
 	
 	if (typeName == "intBool")
 	{
-		vfxNode = new VfxNodeBoolLiteral();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeBoolLiteral>();
 	}
 	else if (typeName == "intLiteral")
 	{
-		vfxNode = new VfxNodeIntLiteral();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeIntLiteral>();
 	}
 	else if (typeName == "floatLiteral")
 	{
-		vfxNode = new VfxNodeFloatLiteral();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeFloatLiteral>();
 	}
 	else if (typeName == "transformLiteral")
 	{
-		vfxNode = new VfxNodeTransformLiteral();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeTransformLiteral>();
 	}
 	else if (typeName == "stringLiteral")
 	{
-		vfxNode = new VfxNodeStringLiteral();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeStringLiteral>();
 	}
 	else if (typeName == "colorLiteral")
 	{
-		vfxNode = new VfxNodeColorLiteral();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeColorLiteral>();
 	}
-	DefineNodeImpl("ccl", VfxNodeCCL)
 	DefineNodeImpl("ccl.osc", VfxNodeCclOsc)
 	DefineNodeImpl("ccl.kinect", VfxNodeCclKinect)
+	DefineNodeImpl("ccl.kinect.pointcloud", VfxNodeCclKinectPointCloud)
+	DefineNodeImpl("ccl.kinect.blobs", VfxNodeCclKinectBlobs)
 	DefineNodeImpl("trigger.asFloat", VfxNodeTriggerAsFloat)
 	DefineNodeImpl("time", VfxNodeTime)
 	DefineNodeImpl("sampleAndHold", VfxNodeSampleAndHold)
@@ -604,39 +611,48 @@ static VfxNodeBase * createVfxNode(const GraphNodeId nodeId, const std::string &
 	DefineNodeImpl("osc.square", VfxNodeOscSquare)
 	else if (typeName == "display")
 	{
-		vfxNode = new VfxNodeDisplay();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeDisplay>();
 		
 		// fixme : move display node id handling out of here. remove nodeId and vfxGraph passed in to this function
 		Assert(vfxGraph->displayNodeId == kGraphNodeIdInvalid);
 		vfxGraph->displayNodeId = nodeId;
 	}
+	else if (typeName == "ccl")
+	{
+		VfxNodeCCL * cclNode = vfxGraph->arena.constructUntracked<VfxNodeCCL>();
+		
+		// note : the population runs its jobs on the graph's scheduler
+		cclNode->population.scheduler = vfxGraph->scheduler;
+		
+		vfxNode = cclNode;
+	}
 	else if (typeName == "mouse")
 	{
-		vfxNode = new VfxNodeMouse();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeMouse>();
 	}
 	else if (typeName == "leap")
 	{
-		vfxNode = new VfxNodeLeapMotion();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeLeapMotion>();
 	}
 	else if (typeName == "osc")
 	{
-		vfxNode = new VfxNodeOsc();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeOsc>();
 	}
 	else if (typeName == "composite")
 	{
-		vfxNode = new VfxNodeComposite();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeComposite>();
 	}
 	else if (typeName == "picture")
 	{
-		vfxNode = new VfxNodePicture();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodePicture>();
 	}
 	else if (typeName == "video")
 	{
-		vfxNode = new VfxNodeVideo();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeVideo>();
 	}
 	else if (typeName == "fsfx")
 	{
-		vfxNode = new VfxNodeFsfx();
+		vfxNode = vfxGraph->arena.constructUntracked<VfxNodeFsfx>();
 	}
 	else
 	{
@@ -648,9 +664,114 @@ static VfxNodeBase * createVfxNode(const GraphNodeId nodeId, const std::string &
 	return vfxNode;
 }
 
-static VfxGraph * constructVfxGraph(const Graph & graph, const GraphEdit_TypeDefinitionLibrary * typeDefinitionLibrary)
+static bool initInputsHaveChanged(const VfxGraph * vfxGraph, const VfxNodeBase * vfxNode, const GraphNode & node, const Graph & graph, const GraphEdit_TypeDefinitionLibrary * typeDefinitionLibrary)
 {
-	VfxGraph * vfxGraph = new VfxGraph();
+	// init inputs are only read when the node is initialized. compare the literal values the node was
+	// initialized with to the literal values in the graph, to see if the node must be initialized again
+	
+	auto typeDefinition = typeDefinitionLibrary->tryGetTypeDefinition(node.typeName);
+	
+	if (typeDefinition == nullptr)
+		return false;
+	
+	for (size_t i = 0; i < typeDefinition->inputSockets.size() && i < vfxNode->inputs.size(); ++i)
+	{
+		const VfxPlug & input = vfxNode->inputs[i];
+		
+		if (input.isInitInput == false)
+			continue;
+		
+		// literal values are only applied to inputs which aren't linked
+		
+		bool isLinked = false;
+		
+		for (auto & linkItr : graph.links)
+		{
+			auto & link = linkItr.second;
+			
+			if (link.isEnabled && link.srcNodeId == node.id && link.srcNodeSocketIndex == int(i))
+				isLinked = true;
+		}
+		
+		std::string newValue;
+		
+		if (isLinked == false)
+		{
+			auto inputValueItr = node.editorInputValues.find(typeDefinition->inputSockets[i].name);
+			
+			if (inputValueItr != node.editorInputValues.end())
+				newValue = inputValueItr->second;
+		}
+		
+		std::string oldValue;
+		
+		auto literalItr = vfxGraph->literals.find(const_cast<VfxPlug*>(&input));
+		
+		if (literalItr != vfxGraph->literals.end() && literalItr->second.value == input.mem)
+			oldValue = literalItr->second.text;
+		
+		if (newValue != oldValue)
+			return true;
+	}
+	
+	return false;
+}
+
+static void patchVfxGraph(VfxGraph * vfxGraph, const Graph & graph, const GraphEdit_TypeDefinitionLibrary * typeDefinitionLibrary)
+{
+	// patch the vfx graph so it matches graph. nodes with the same id and type are kept, including their
+	// state, so we don't reopen media, reallocate surfaces, etc for nodes which didn't change. all links
+	// and literal values are re-applied, and only new nodes are created and initialized. nodes for which
+	// the value of an init input changed are recreated, as they only read these inputs when initialized
+	
+	// note : literal values of kept nodes are destroyed and re-allocated from the arena. their memory, and the
+	//        memory of removed nodes, is recycled by the arena
+	
+	for (auto vfxNodeItr = vfxGraph->nodes.begin(); vfxNodeItr != vfxGraph->nodes.end(); )
+	{
+		const GraphNodeId nodeId = vfxNodeItr->first;
+		
+		auto nodeItr = graph.nodes.find(nodeId);
+		
+		const bool keep =
+			nodeItr != graph.nodes.end() &&
+			nodeItr->second.isEnabled &&
+			nodeItr->second.typeName == vfxGraph->nodeTypeNames[nodeId] &&
+			initInputsHaveChanged(vfxGraph, vfxNodeItr->second, nodeItr->second, graph, typeDefinitionLibrary) == false;
+		
+		if (keep)
+		{
+			++vfxNodeItr;
+		}
+		else
+		{
+			if (nodeId == vfxGraph->displayNodeId)
+				vfxGraph->displayNodeId = kGraphNodeIdInvalid;
+			
+			vfxGraph->destroyNode(vfxNodeItr->second);
+			
+			vfxGraph->nodeTypeNames.erase(nodeId);
+			
+			vfxNodeItr = vfxGraph->nodes.erase(vfxNodeItr);
+		}
+	}
+	
+	for (auto & vfxNodeItr : vfxGraph->nodes)
+	{
+		VfxNodeBase * vfxNode = vfxNodeItr.second;
+		
+		vfxNode->predeps.clear();
+		vfxNode->triggerTargets.clear();
+		
+		for (auto & input : vfxNode->inputs)
+		{
+			vfxGraph->destroyInputLiteral(input);
+			
+			input.disconnect();
+		}
+	}
+	
+	std::set<VfxNodeBase*> newNodes;
 	
 	for (auto nodeItr : graph.nodes)
 	{
@@ -661,6 +782,19 @@ static VfxGraph * constructVfxGraph(const Graph & graph, const GraphEdit_TypeDef
 			continue;
 		}
 		
+		auto vfxNodeItr = vfxGraph->nodes.find(node.id);
+		
+		if (vfxNodeItr != vfxGraph->nodes.end())
+		{
+			VfxNodeBase * vfxNode = vfxNodeItr->second;
+			
+			vfxNode->isPassthrough = node.editorIsPassthrough;
+			
+			vfxNode->initSelf(node);
+			
+			continue;
+		}
+		
 		VfxNodeBase * vfxNode = createVfxNode(node.id, node.typeName, vfxGraph);
 		
 		Assert(vfxNode != nullptr);
@@ -675,6 +809,9 @@ static VfxGraph * constructVfxGraph(const Graph & graph, const GraphEdit_TypeDef
 			vfxNode->initSelf(node);
 			
 			vfxGraph->nodes[node.id] = vfxNode;
+			vfxGraph->nodeTypeNames[node.id] = node.typeName;
+			
+			newNodes.insert(vfxNode);
 		}
 	}
 	
@@ -719,7 +856,7 @@ static VfxGraph * constructVfxGraph(const Graph & graph, const GraphEdit_TypeDef
 				input->connectTo(*output);
 				
 				// note : this may add the same node multiple times to the list of predeps. note that this
-				//        is ok as nodes will be traversed once through the travel id + it works nicely
+				//        is ok as duplicates are removed when the execution plan is compiled + it works nicely
 				//        with the live connection as we can just remove the predep and still have one or
 				//        references to the predep if the predep was referenced more than once
 				srcNode->predeps.push_back(dstNode);
@@ -784,9 +921,26 @@ static VfxGraph * constructVfxGraph(const Graph & graph, const GraphEdit_TypeDef
 		auto & node = nodeItr->second;
 		auto vfxNode = vfxNodeItr.second;
 		
-		vfxNode->init(node);
+		if (newNodes.count(vfxNode) != 0)
+		{
+			vfxNode->init(node);
+		}
 	}
 	
+	vfxGraph->invalidateExecutionPlan();
+	vfxGraph->updateExecutionPlan();
+}
+
+static VfxGraph * constructVfxGraph(const Graph & graph, const GraphEdit_TypeDefinitionLibrary * typeDefinitionLibrary, VfxScheduler * scheduler)
+{
+	VfxGraph * vfxGraph = new VfxGraph();
+	
+	// note : the scheduler is set before creating the nodes, as some nodes share it
+	
+	vfxGraph->scheduler = scheduler;
+	
+	patchVfxGraph(vfxGraph, graph, typeDefinitionLibrary);
+	
 	return vfxGraph;
 }
 
@@ -795,29 +949,61 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 	VfxGraph * vfxGraph;
 	VfxGraph ** vfxGraphPtr;
 	
+	VfxScheduler * scheduler;
+	
+	GraphEdit * graphEdit;
+	
 	bool isLoading;
 	
+	bool hasPendingInitInputs; // set when an init input changed, until the graph is patched by applyInitInputChanges
+	
 	RealTimeConnection()
 		: GraphEdit_RealTimeConnection()
 		, vfxGraph(nullptr)
 		, vfxGraphPtr(nullptr)
+		, scheduler(nullptr)
+		, graphEdit(nullptr)
 		, isLoading(false)
+		, hasPendingInitInputs(false)
 	{
 	}
 	
+	// recreates the nodes whose init inputs changed. called once per frame. text fields report every keystroke
+	// as a change, so the graph isn't patched until editing is finished, by pressing enter or clicking elsewhere
+	
+	void applyInitInputChanges()
+	{
+		if (!hasPendingInitInputs || vfxGraph == nullptr || graphEdit == nullptr)
+			return;
+		
+		if (graphEdit->propertyEditor->uiState->isEditingText())
+			return;
+		
+		hasPendingInitInputs = false;
+		
+		patchVfxGraph(vfxGraph, *graphEdit->graph, graphEdit->typeDefinitionLibrary);
+	}
+	
 	virtual void loadBegin() override
 	{
 		isLoading = true;
 		
-		delete vfxGraph;
-		vfxGraph = nullptr;
-		*vfxGraphPtr = nullptr;
+		// note : we keep the current vfx graph around, so we can patch it when loading is done
 	}
 	
 	virtual void loadEnd(GraphEdit & graphEdit) override
 	{
-		vfxGraph = constructVfxGraph(*graphEdit.graph, graphEdit.typeDefinitionLibrary);
-		*vfxGraphPtr = vfxGraph;
+		hasPendingInitInputs = false;
+		
+		if (vfxGraph != nullptr)
+		{
+			patchVfxGraph(vfxGraph, *graphEdit.graph, graphEdit.typeDefinitionLibrary);
+		}
+		else
+		{
+			vfxGraph = constructVfxGraph(*graphEdit.graph, graphEdit.typeDefinitionLibrary, scheduler);
+			*vfxGraphPtr = vfxGraph;
+		}
 		
 		isLoading = false;
 	}
@@ -855,10 +1041,13 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 		vfxNode->initSelf(node);
 		
 		vfxGraph->nodes[node.id] = vfxNode;
+		vfxGraph->nodeTypeNames[node.id] = typeName;
 		
 		//
 		
 		vfxNode->init(node);
+		
+		vfxGraph->invalidateExecutionPlan();
 	}
 	
 	virtual void nodeRemove(const GraphNodeId nodeId) override
@@ -886,10 +1075,16 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 		//	Assert(!input.isConnected()); // may be a literal value node with a non-accounted for (in the graph) connection when created directly from socket value
 		// todo : iterate all other nodes, to ensure there are no nodes with references back to this node?
 		
-		delete node;
+		vfxGraph->destroyNode(node);
 		node = nullptr;
 		
 		vfxGraph->nodes.erase(nodeItr);
+		vfxGraph->nodeTypeNames.erase(nodeId);
+		
+		if (nodeId == vfxGraph->displayNodeId)
+			vfxGraph->displayNodeId = kGraphNodeIdInvalid;
+		
+		vfxGraph->invalidateExecutionPlan();
 	}
 	
 	virtual void linkAdd(const GraphLinkId linkId, const GraphNodeId srcNodeId, const int srcSocketIndex, const GraphNodeId dstNodeId, const int dstSocketIndex) override
@@ -937,7 +1132,7 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 		input->connectTo(*output);
 		
 		// note : this may add the same node multiple times to the list of predeps. note that this
-		//        is ok as nodes will be traversed once through the travel id + it works nicely
+		//        is ok as duplicates are removed when the execution plan is compiled + it works nicely
 		//        with the live connection as we can just remove the predep and still have one or
 		//        references to the predep if the predep was referenced more than once
 		srcNode->predeps.push_back(dstNode);
@@ -952,6 +1147,8 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 			
 			dstNode->triggerTargets.push_back(triggerTarget);
 		}
+		
+		vfxGraph->invalidateExecutionPlan();
 	}
 	
 	virtual void linkRemove(const GraphLinkId linkId, const GraphNodeId srcNodeId, const int srcSocketIndex, const GraphNodeId dstNodeId, const int dstSocketIndex) override
@@ -1007,6 +1204,8 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 				}
 				
 				Assert(foundPredep);
+				
+				vfxGraph->invalidateExecutionPlan();
 			}
 		}
 		
@@ -1060,6 +1259,8 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 		auto node = nodeItr->second;
 		
 		node->isPassthrough = isPassthrough;
+		
+		node->markDirty();
 	}
 	
 	static bool setPlugValue(VfxPlug * plug, const std::string & value)
@@ -1094,6 +1295,8 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 			return false;
 		case kVfxPlugType_Trigger:
 			return false;
+		case kVfxPlugType_FloatArray:
+			return false;
 		}
 		
 		Assert(false); // all cases should be handled explicitly
@@ -1125,9 +1328,21 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 		if (input == nullptr)
 			return;
 		
-		if (input->isConnected())
+		if (input->isInitInput)
 		{
-			setPlugValue(input, value);
+			// the node only reads the input when it's initialized. the node is recreated by applyInitInputChanges
+			
+			hasPendingInitInputs = true;
+		}
+		else if (input->isConnected())
+		{
+			if (setPlugValue(input, value))
+				input->markChanged();
+			
+			auto literalItr = vfxGraph->literals.find(input);
+			
+			if (literalItr != vfxGraph->literals.end() && literalItr->second.value == input->mem)
+				literalItr->second.text = value;
 		}
 		else
 		{
@@ -1181,6 +1396,11 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 					value = String::FormatC("%f", triggerData.asFloat());
 					return true;
 				}
+				else if (triggerData.type == kVfxTriggerDataType_FloatArray)
+				{
+					value = String::FormatC("[%d]", triggerData.asInt());
+					return true;
+				}
 				else
 				{
 					Assert(false);
@@ -1188,6 +1408,22 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 				}
 			}
 			return false;
+		case kVfxPlugType_FloatArray:
+			{
+				const VfxFloatArray & floatArray = plug->getFloatArray();
+				
+				value.clear();
+				
+				for (int i = 0; i < floatArray.size(); ++i)
+				{
+					if (i != 0)
+						value.push_back(',');
+					
+					value += String::FormatC("%.2f", floatArray[i]);
+				}
+				
+				return true;
+			}
 		}
 		
 		Assert(false); // all cases should be handled explicitly
@@ -1248,7 +1484,8 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 		if (output == nullptr)
 			return;
 		
-		setPlugValue(output, value);
+		if (setPlugValue(output, value))
+			output->markChanged();
 	}
 	
 	virtual bool getDstSocketValue(const GraphNodeId nodeId, const int dstSocketIndex, const std::string & dstSocketName, std::string & value) override
@@ -1320,6 +1557,36 @@ struct RealTimeConnection : GraphEdit_RealTimeConnection
 
 int main(int argc, char * argv[])
 {
+	if (argc >= 2 && !strcmp(argv[1], "-evolve"))
+	{
+		// evolve the ccl dancer population ahead of time, without opening a window. usage:
+		// avgraph -evolve motionbank=<file> checkpoint=<file> [duration=<seconds>] [population=<size>] ..
+		
+		CclEvolveSettings settings;
+		
+		for (int i = 2; i < argc; ++i)
+		{
+			if (!settings.parse(argv[i]))
+			{
+				logError("invalid argument: %s", argv[i]);
+				return -1;
+			}
+		}
+		
+		return evolvePopulation_MotionBank(settings) ? 0 : -1;
+	}
+	
+	// the serials of the kinects to use, in the order they should be assigned device ids. usage:
+	// avgraph -kinect <serial> -kinect <serial> ..
+	
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (!strcmp(argv[i], "-kinect"))
+		{
+			g_kinectManager.configuredSerials.push_back(argv[++i]);
+		}
+	}
+	
 	//framework.waitForEvents = true;
 	
 	framework.enableRealTimeEditing = true;
@@ -1365,16 +1632,30 @@ int main(int argc, char * argv[])
 		
 		//
 		
+		// tick independent nodes in parallel using one worker thread per additional core
+		
+		VfxScheduler * scheduler = new VfxScheduler();
+		
+		scheduler->init(std::max(0, SDL_GetCPUCount() - 1));
+		
+		//
+		
 		RealTimeConnection * realTimeConnection = new RealTimeConnection();
 		
+		realTimeConnection->scheduler = scheduler;
+		
 		//
 		
 		GraphEdit * graphEdit = new GraphEdit(typeDefinitionLibrary);
 		
 		graphEdit->realTimeConnection = realTimeConnection;
+		
+		realTimeConnection->graphEdit = graphEdit;
 
 		VfxGraph * vfxGraph = new VfxGraph();
 		
+		vfxGraph->scheduler = scheduler;
+		
 		realTimeConnection->vfxGraph = vfxGraph;
 		realTimeConnection->vfxGraphPtr = &vfxGraph;
 		
@@ -1410,6 +1691,8 @@ int main(int argc, char * argv[])
 				graphEdit->propertyEditor->setNode(nodeId);
 			}
 			
+			realTimeConnection->applyInitInputChanges();
+			
 			framework.beginDraw(31, 31, 31, 255);
 			{
 				if (vfxGraph != nullptr)
@@ -1429,6 +1712,9 @@ int main(int argc, char * argv[])
 		delete realTimeConnection;
 		realTimeConnection = nullptr;
 		
+		delete scheduler;
+		scheduler = nullptr;
+		
 		delete typeDefinitionLibrary;
 		typeDefinitionLibrary = nullptr;
 		
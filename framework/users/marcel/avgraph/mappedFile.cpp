@@ -0,0 +1,129 @@
+#include "framework.h"
+#include "mappedFile.h"
+#include <sys/stat.h>
+
+#ifdef WIN32
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+	: data(nullptr)
+	, size(0)
+#ifdef WIN32
+	, fileHandle(nullptr)
+	, mappingHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const char * filename)
+{
+	close();
+	
+#ifdef WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	
+	LARGE_INTEGER fileSize;
+	
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	
+	void * view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	
+	if (view == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	
+	fileHandle = file;
+	mappingHandle = mapping;
+	
+	data = view;
+	size = (size_t)fileSize.QuadPart;
+#else
+	const int fd = ::open(filename, O_RDONLY);
+	
+	if (fd < 0)
+		return false;
+	
+	struct stat s;
+	
+	if (fstat(fd, &s) != 0 || s.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+	
+	void * view = mmap(nullptr, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	
+	// note : the mapping stays valid after the file descriptor is closed
+	
+	::close(fd);
+	
+	if (view == MAP_FAILED)
+		return false;
+	
+	data = view;
+	size = s.st_size;
+#endif
+	
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data == nullptr)
+		return;
+	
+#ifdef WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+	
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	munmap(const_cast<void*>(data), size);
+#endif
+	
+	data = nullptr;
+	size = 0;
+}
+
+bool MappedFile::getFileInfo(const char * filename, uint64_t & modificationTime, uint64_t & fileSize)
+{
+	struct stat s;
+	
+	if (stat(filename, &s) != 0)
+		return false;
+	
+	modificationTime = s.st_mtime;
+	fileSize = s.st_size;
+	
+	return true;
+}
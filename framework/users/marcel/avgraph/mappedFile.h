@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+
+MappedFile maps a file into memory read-only, so its contents can be used in place without reading
+them into a buffer first. pages are loaded on demand by the operating system.
+
+*/
+
+struct MappedFile
+{
+	const void * data;
+	size_t size;
+	
+#ifdef WIN32
+	void * fileHandle;
+	void * mappingHandle;
+#endif
+	
+	MappedFile();
+	~MappedFile();
+	
+	bool open(const char * filename);
+	void close();
+	
+	bool isOpen() const
+	{
+		return data != nullptr;
+	}
+	
+	// returns the modification time and size of a file, without opening it
+	
+	static bool getFileInfo(const char * filename, uint64_t & modificationTime, uint64_t & fileSize);
+	
+private:
+	MappedFile(const MappedFile & other);
+	MappedFile & operator=(const MappedFile & other);
+};
@@ -0,0 +1,302 @@
+#include "framework.h"
+#include "oscRouteTable.h"
+#include <algorithm>
+#include <string.h>
+
+static const char * findSegmentEnd(const char * segment)
+{
+	while (*segment != 0 && *segment != '/')
+		segment++;
+	
+	return segment;
+}
+
+static int compareSegment(const std::string & segment, const char * begin, const char * end)
+{
+	const size_t length = end - begin;
+	const size_t minLength = std::min(segment.size(), length);
+	
+	const int result = memcmp(segment.c_str(), begin, minLength);
+	
+	if (result != 0)
+		return result;
+	else
+		return segment.size() < length ? -1 : segment.size() > length ? +1 : 0;
+}
+
+//
+
+OscRouteTable::OscRouteTable()
+	: nodes()
+{
+	clear();
+}
+
+void OscRouteTable::clear()
+{
+	nodes.clear();
+	
+	// add the root node
+	
+	nodes.resize(1);
+}
+
+bool OscRouteTable::addRoute(const char * pattern, const int routeId)
+{
+	Assert(routeId != kInvalidRouteId);
+	
+	if (pattern[0] != '/')
+	{
+		logError("invalid OSC address pattern: %s. address patterns must start with a '/'", pattern);
+		return false;
+	}
+	
+	int nodeIndex = 0;
+	
+	const char * segment = pattern + 1;
+	
+	for (;;)
+	{
+		const char * segmentEnd = findSegmentEnd(segment);
+		
+		const bool isWildcard = isWildcardSegment(segment, segmentEnd);
+		
+		// note : nodes may be reallocated when adding a child, so don't keep references to them around
+		
+		std::vector<Child> & children = isWildcard ? nodes[nodeIndex].wildcardChildren : nodes[nodeIndex].literalChildren;
+		
+		auto i = children.begin();
+		
+		if (isWildcard)
+		{
+			while (i != children.end() && compareSegment(i->segment, segment, segmentEnd) != 0)
+				++i;
+		}
+		else
+		{
+			i = std::lower_bound(children.begin(), children.end(), segment, [&](const Child & child, const char * begin) { return compareSegment(child.segment, begin, segmentEnd) < 0; });
+			
+			if (i != children.end() && compareSegment(i->segment, segment, segmentEnd) != 0)
+				i = children.end();
+		}
+		
+		if (i != children.end())
+		{
+			nodeIndex = i->nodeIndex;
+		}
+		else
+		{
+			Child child;
+			child.segment.assign(segment, segmentEnd);
+			child.nodeIndex = nodes.size();
+			
+			if (isWildcard)
+				children.push_back(child);
+			else
+				children.insert(std::lower_bound(children.begin(), children.end(), child, [](const Child & a, const Child & b) { return a.segment < b.segment; }), child);
+			
+			nodeIndex = child.nodeIndex;
+			
+			nodes.resize(nodes.size() + 1);
+		}
+		
+		if (*segmentEnd == 0)
+			break;
+		
+		segment = segmentEnd + 1;
+	}
+	
+	if (nodes[nodeIndex].routeId != kInvalidRouteId)
+	{
+		logError("OSC address pattern %s is already registered", pattern);
+		return false;
+	}
+	
+	nodes[nodeIndex].routeId = routeId;
+	
+	return true;
+}
+
+int OscRouteTable::match(const char * address) const
+{
+	if (address[0] != '/')
+		return kInvalidRouteId;
+	
+	return matchNode(0, address + 1);
+}
+
+int OscRouteTable::matchNode(const int nodeIndex, const char * segment) const
+{
+	const Node & node = nodes[nodeIndex];
+	
+	const char * segmentEnd = findSegmentEnd(segment);
+	
+	const bool isLast = *segmentEnd == 0;
+	
+	const char * nextSegment = isLast ? segmentEnd : segmentEnd + 1;
+	
+	// try the literal segments first
+	
+	auto i = std::lower_bound(node.literalChildren.begin(), node.literalChildren.end(), segment, [&](const Child & child, const char * begin) { return compareSegment(child.segment, begin, segmentEnd) < 0; });
+	
+	if (i != node.literalChildren.end() && compareSegment(i->segment, segment, segmentEnd) == 0)
+	{
+		const int routeId = isLast ? nodes[i->nodeIndex].routeId : matchNode(i->nodeIndex, nextSegment);
+		
+		if (routeId != kInvalidRouteId)
+			return routeId;
+	}
+	
+	for (auto & child : node.wildcardChildren)
+	{
+		const char * pattern = child.segment.c_str();
+		
+		if (matchSegment(pattern, pattern + child.segment.size(), segment, segmentEnd))
+		{
+			const int routeId = isLast ? nodes[child.nodeIndex].routeId : matchNode(child.nodeIndex, nextSegment);
+			
+			if (routeId != kInvalidRouteId)
+				return routeId;
+		}
+	}
+	
+	return kInvalidRouteId;
+}
+
+bool OscRouteTable::isWildcardSegment(const char * begin, const char * end)
+{
+	for (const char * c = begin; c != end; ++c)
+		if (*c == '?' || *c == '*' || *c == '[' || *c == '{')
+			return true;
+	
+	return false;
+}
+
+bool OscRouteTable::matchSegment(const char * pattern, const char * patternEnd, const char * text, const char * textEnd)
+{
+	while (pattern != patternEnd)
+	{
+		switch (*pattern)
+		{
+		case '?':
+			{
+				if (text == textEnd)
+					return false;
+				
+				pattern++;
+				text++;
+			}
+			break;
+		
+		case '*':
+			{
+				// collapse consecutive stars and try to match the remainder of the pattern at every position
+				
+				while (pattern != patternEnd && *pattern == '*')
+					pattern++;
+				
+				if (pattern == patternEnd)
+					return true;
+				
+				for (const char * t = text; t <= textEnd; ++t)
+					if (matchSegment(pattern, patternEnd, t, textEnd))
+						return true;
+				
+				return false;
+			}
+		
+		case '[':
+			{
+				if (text == textEnd)
+					return false;
+				
+				pattern++;
+				
+				const bool negate = pattern != patternEnd && *pattern == '!';
+				
+				if (negate)
+					pattern++;
+				
+				bool matches = false;
+				
+				while (pattern != patternEnd && *pattern != ']')
+				{
+					if (pattern + 2 < patternEnd && pattern[1] == '-' && pattern[2] != ']')
+					{
+						if (*text >= pattern[0] && *text <= pattern[2])
+							matches = true;
+						
+						pattern += 3;
+					}
+					else
+					{
+						if (*text == *pattern)
+							matches = true;
+						
+						pattern++;
+					}
+				}
+				
+				if (pattern == patternEnd)
+					return false; // unterminated character set
+				
+				pattern++;
+				
+				if (matches == negate)
+					return false;
+				
+				text++;
+			}
+			break;
+		
+		case '{':
+			{
+				const char * alternativesEnd = pattern;
+				
+				while (alternativesEnd != patternEnd && *alternativesEnd != '}')
+					alternativesEnd++;
+				
+				if (alternativesEnd == patternEnd)
+					return false; // unterminated list of alternatives
+				
+				const char * alternative = pattern + 1;
+				
+				for (;;)
+				{
+					const char * alternativeEnd = alternative;
+					
+					while (alternativeEnd != alternativesEnd && *alternativeEnd != ',')
+						alternativeEnd++;
+					
+					const size_t length = alternativeEnd - alternative;
+					
+					if (size_t(textEnd - text) >= length &&
+						memcmp(text, alternative, length) == 0 &&
+						matchSegment(alternativesEnd + 1, patternEnd, text + length, textEnd))
+					{
+						return true;
+					}
+					
+					if (alternativeEnd == alternativesEnd)
+						break;
+					
+					alternative = alternativeEnd + 1;
+				}
+				
+				return false;
+			}
+		
+		default:
+			{
+				if (text == textEnd || *text != *pattern)
+					return false;
+				
+				pattern++;
+				text++;
+			}
+			break;
+		}
+	}
+	
+	return text == textEnd;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "osc/OscPacketListener.h"
+#include <string>
+#include <vector>
+
+/*
+
+OscRouteTable maps OSC addresses to integer route ids. address patterns are registered once and compiled
+into a trie with one level per address segment. literal segments are looked up by binary search, and
+segments containing OSC wildcards ('?', '*', '[a-z]', '[!abc]' and '{foo,bar}') are matched against the
+address segment directly. matching an address doesn't allocate memory, and is linear in the length of
+the address for tables without wildcard segments.
+
+when more than one pattern matches an address, literal segments take precedence over wildcard segments,
+and wildcard segments are tried in order of registration.
+
+usage:
+	
+	OscRouteTable routes;
+	
+	routes.addRoute("/joints", kRoute_Joints);
+	routes.addRoute("/k2/rig[0-9]/joints", kRoute_Joints);
+	
+	const int routeId = routes.match(m.AddressPattern());
+
+*/
+
+struct OscRouteTable
+{
+	static const int kInvalidRouteId = -1;
+	
+	struct Child
+	{
+		std::string segment;
+		int nodeIndex;
+	};
+	
+	struct Node
+	{
+		std::vector<Child> literalChildren; // sorted by segment
+		std::vector<Child> wildcardChildren;
+		
+		int routeId;
+		
+		Node()
+			: literalChildren()
+			, wildcardChildren()
+			, routeId(kInvalidRouteId)
+		{
+		}
+	};
+	
+	std::vector<Node> nodes;
+	
+	OscRouteTable();
+	
+	void clear();
+	
+	bool addRoute(const char * pattern, const int routeId);
+	
+	int match(const char * address) const;
+	
+	static bool isWildcardSegment(const char * begin, const char * end);
+	static bool matchSegment(const char * pattern, const char * patternEnd, const char * text, const char * textEnd);
+	
+	int matchNode(const int nodeIndex, const char * address) const;
+};
+
+/*
+
+RoutingOscPacketListener dispatches messages to typed handlers using a route table. it's modeled after
+osc::MessageMappingOscPacketListener, but matches address patterns using OscRouteTable instead of looking
+up the full address in a string map, and passes the route id along to the handler.
+
+*/
+
+template <typename T>
+class RoutingOscPacketListener : public osc::OscPacketListener
+{
+public:
+	typedef void (T::*function_type)(const osc::ReceivedMessage & m, const int routeId, const IpEndpointName & remoteEndpoint);
+
+protected:
+	OscRouteTable routes;
+	std::vector<function_type> functions; // indexed by route id
+	
+	void RegisterRoute(const char * addressPattern, const int routeId, function_type f)
+	{
+		if (routeId < 0 || !routes.addRoute(addressPattern, routeId))
+			return;
+		
+		if (routeId >= (int)functions.size())
+			functions.resize(routeId + 1, nullptr);
+		
+		functions[routeId] = f;
+	}
+	
+	virtual void ProcessUnroutedMessage(const osc::ReceivedMessage & m, const IpEndpointName & remoteEndpoint)
+	{
+	}
+	
+	virtual void ProcessMessage(const osc::ReceivedMessage & m, const IpEndpointName & remoteEndpoint) override
+	{
+		const int routeId = routes.match(m.AddressPattern());
+		
+		if (routeId != OscRouteTable::kInvalidRouteId && functions[routeId] != nullptr)
+			(static_cast<T*>(this)->*functions[routeId])(m, routeId, remoteEndpoint);
+		else
+			ProcessUnroutedMessage(m, remoteEndpoint);
+	}
+};
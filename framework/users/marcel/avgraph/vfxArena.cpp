@@ -0,0 +1,130 @@
+#include "Debugging.h"
+#include "vfxArena.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+VfxArena::VfxArena(const size_t _blockSize)
+	: block(nullptr)
+	, destructors(nullptr)
+	, freeLists()
+	, blockSize(_blockSize)
+{
+}
+
+VfxArena::~VfxArena()
+{
+	reset();
+}
+
+void VfxArena::reset()
+{
+	// destruct objects in reverse order of construction
+	
+	while (destructors != nullptr)
+	{
+		Destructor * destructor = destructors;
+		
+		destructors = destructor->next;
+		
+		destructor->destruct(destructor->object);
+	}
+	
+	while (block != nullptr)
+	{
+		Block * next = block->next;
+		
+		free(block);
+		
+		block = next;
+	}
+	
+	for (auto & freeList : freeLists)
+		freeList = nullptr;
+}
+
+void * VfxArena::alloc(const size_t size, const size_t alignment)
+{
+	Assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+	
+	// the block header is followed by the block data. align relative to the actual address
+	
+	if (block != nullptr)
+	{
+		const uintptr_t begin = (uintptr_t)(block + 1);
+		const uintptr_t current = begin + block->used;
+		const uintptr_t aligned = (current + alignment - 1) & ~uintptr_t(alignment - 1);
+		
+		if (aligned + size <= begin + block->size)
+		{
+			block->used = aligned + size - begin;
+			
+			return (void*)aligned;
+		}
+	}
+	
+	// allocate a new block. objects larger than the default block size get a block of their own
+	
+	const size_t dataSize = size + alignment > blockSize ? size + alignment : blockSize;
+	
+	Block * newBlock = (Block*)malloc(sizeof(Block) + dataSize);
+	
+	const uintptr_t begin = (uintptr_t)(newBlock + 1);
+	const uintptr_t aligned = (begin + alignment - 1) & ~uintptr_t(alignment - 1);
+	
+	newBlock->size = dataSize;
+	newBlock->used = aligned + size - begin;
+	
+	if (dataSize > blockSize && block != nullptr)
+	{
+		// keep allocating from the current block, as the new block is filled up by this allocation
+		
+		newBlock->next = block->next;
+		block->next = newBlock;
+	}
+	else
+	{
+		newBlock->next = block;
+		block = newBlock;
+	}
+	
+	return (void*)aligned;
+}
+
+void * VfxArena::allocRecyclable(const size_t size)
+{
+	// round the allocation up to a power of two, so released memory can be reused by any allocation of the
+	// same size class
+	
+	int sizeClass = 0;
+	
+	while ((kMinRecycleSize << sizeClass) < kRecycleHeaderSize + size)
+		sizeClass++;
+	
+	Assert(sizeClass < kNumSizeClasses);
+	
+	uint8_t * mem = (uint8_t*)freeLists[sizeClass];
+	
+	if (mem != nullptr)
+		freeLists[sizeClass] = *(void**)mem;
+	else
+		mem = (uint8_t*)alloc(kMinRecycleSize << sizeClass, kRecycleHeaderSize);
+	
+	*(size_t*)mem = sizeClass;
+	
+	return mem + kRecycleHeaderSize;
+}
+
+void VfxArena::release(void * object)
+{
+	if (object == nullptr)
+		return;
+	
+	uint8_t * mem = (uint8_t*)object - kRecycleHeaderSize;
+	
+	const size_t sizeClass = *(size_t*)mem;
+	
+	Assert(sizeClass < kNumSizeClasses);
+	
+	*(void**)mem = freeLists[sizeClass];
+	freeLists[sizeClass] = mem;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+
+/*
+
+VfxArena is a bump allocator owning the memory of a single VfxGraph. objects allocated through
+construct are destructed in reverse order of construction when the arena is reset. memory is
+allocated in large blocks and only released on reset, so freeing a graph costs one free per block.
+
+objects which may be destroyed before the arena is reset, like the nodes and literal values of a graph
+which is edited live, are allocated through constructUntracked and destroyed through destroy. their
+memory is rounded up to a power of two, and kept on a free list for its size when the object is
+destroyed, so it can be recycled by the next object of a similar size.
+
+usage:
+	
+	VfxArena arena;
+	
+	float * value = arena.construct<float>(1.f);
+	std::string * text = arena.construct<std::string>("hello"); // destructor is called on reset
+	
+	std::string * name = arena.constructUntracked<std::string>("node");
+	arena.destroy(name); // the memory is recycled
+	
+	arena.reset();
+
+*/
+
+struct VfxArena
+{
+	struct Block
+	{
+		Block * next;
+		size_t size;
+		size_t used;
+	};
+	
+	struct Destructor
+	{
+		Destructor * next;
+		void (*destruct)(void * object);
+		void * object;
+	};
+	
+	static const size_t kDefaultBlockSize = 256 * 1024;
+	
+	// recyclable allocations are preceded by a header holding their size class. the header size is also the
+	// maximum alignment supported for recyclable allocations
+	
+	static const size_t kRecycleHeaderSize = 16;
+	static const size_t kMinRecycleSize = 32;
+	static const int kNumSizeClasses = 40;
+	
+	Block * block;
+	Destructor * destructors;
+	
+	void * freeLists[kNumSizeClasses]; // released allocations, by size class
+	
+	size_t blockSize;
+	
+	VfxArena(const size_t blockSize = kDefaultBlockSize);
+	~VfxArena();
+	
+	void reset();
+	
+	void * alloc(const size_t size, const size_t alignment);
+	
+	void * allocRecyclable(const size_t size);
+	void release(void * object);
+	
+	template <typename T, typename ... Args>
+	T * construct(Args && ... args)
+	{
+		void * mem = alloc(sizeof(T), alignof(T));
+		
+		T * object = new (mem) T(std::forward<Args>(args)...);
+		
+		if (std::is_trivially_destructible<T>::value == false)
+		{
+			Destructor * destructor = (Destructor*)alloc(sizeof(Destructor), alignof(Destructor));
+			
+			destructor->next = destructors;
+			destructor->destruct = [](void * p) { ((T*)p)->~T(); };
+			destructor->object = object;
+			
+			destructors = destructor;
+		}
+		
+		return object;
+	}
+	
+	// construct an object without registering its destructor. the owner is responsible for destroying the
+	// object before the arena is reset. used for objects which may be destroyed before the arena is reset
+	
+	template <typename T, typename ... Args>
+	T * constructUntracked(Args && ... args)
+	{
+		static_assert(alignof(T) <= kRecycleHeaderSize, "alignment not supported for recyclable allocations");
+		
+		void * mem = allocRecyclable(sizeof(T));
+		
+		return new (mem) T(std::forward<Args>(args)...);
+	}
+	
+	// destroy an object constructed with constructUntracked, and recycle its memory. for polymorphic objects,
+	// the pointer must point to the most derived object
+	
+	template <typename T>
+	void destroy(T * object)
+	{
+		object->~T();
+		
+		release(object);
+	}
+};
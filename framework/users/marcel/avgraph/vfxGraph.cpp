@@ -1,18 +1,28 @@
 #include "Parse.h"
 #include "vfxGraph.h"
+#include "vfxScheduler.h"
 #include "vfxNodes/vfxNodeBase.h"
 #include "vfxNodes/vfxNodeDisplay.h"
+#include <set>
 
 extern const int GFX_SX;
 extern const int GFX_SY;
 
 VfxGraph::VfxGraph()
 	: nodes()
+	, nodeTypeNames()
 	, displayNodeId(kGraphNodeIdInvalid)
+	, tickList()
+	, tickLevels()
+	, drawList()
+	, displayNode(nullptr)
+	, executionPlanIsDirty(true)
 	, nextTickTraversalId(0)
 	, nextDrawTraversalId(0)
 	, graph(nullptr)
-	, valuesToFree()
+	, scheduler(nullptr)
+	, arena()
+	, literals()
 {
 }
 
@@ -27,108 +37,106 @@ void VfxGraph::destroy()
 	
 	displayNodeId = kGraphNodeIdInvalid;
 	
-	for (auto i : valuesToFree)
-	{
-		switch (i.type)
-		{
-		case ValueToFree::kType_Bool:
-			delete (bool*)i.mem;
-			break;
-		case ValueToFree::kType_Int:
-			delete (int*)i.mem;
-			break;
-		case ValueToFree::kType_Float:
-			delete (float*)i.mem;
-			break;
-		case ValueToFree::kType_Transform:
-			delete (VfxTransform*)i.mem;
-			break;
-		case ValueToFree::kType_String:
-			delete (std::string*)i.mem;
-			break;
-		case ValueToFree::kType_Color:
-			delete (Color*)i.mem;
-			break;
-		default:
-			Assert(false);
-			break;
-		}
-	}
-	
-	valuesToFree.clear();
-	
 	for (auto i : nodes)
 	{
 		VfxNodeBase * node = i.second;
 		
-		delete node;
+		destroyNode(node);
 		node = nullptr;
 	}
 	
 	nodes.clear();
+	nodeTypeNames.clear();
+	
+	Assert(literals.empty());
+	literals.clear();
+	
+	// free literal values and node memory in one go
+	
+	arena.reset();
+	
+	invalidateExecutionPlan();
+}
+
+void VfxGraph::destroyNode(VfxNodeBase * node)
+{
+	// nodes are constructed in the arena. destroy their literals, and hand their memory back to the arena so
+	// it can be recycled by the next node of a similar size
+	
+	for (auto & input : node->inputs)
+		destroyInputLiteral(input);
+	
+	void * mem = dynamic_cast<void*>(node);
+	
+	node->~VfxNodeBase();
+	
+	arena.release(mem);
+}
+
+template <typename T>
+static T * constructInputLiteral(VfxGraph & vfxGraph, VfxPlug & input, const std::string & text)
+{
+	vfxGraph.destroyInputLiteral(input);
+	
+	T * value = vfxGraph.arena.constructUntracked<T>();
+	
+	VfxGraph::Literal & literal = vfxGraph.literals[&input];
+	literal.value = value;
+	literal.destroy = [](VfxArena & arena, void * value) { arena.destroy((T*)value); };
+	literal.text = text;
+	
+	return value;
 }
 
 void VfxGraph::connectToInputLiteral(VfxPlug & input, const std::string & inputValue)
 {
 	if (input.type == kVfxPlugType_Bool)
 	{
-		bool * value = new bool();
+		bool * value = constructInputLiteral<bool>(*this, input, inputValue);
 		
 		*value = Parse::Bool(inputValue);
 		
 		input.connectTo(value, kVfxPlugType_Bool);
-		
-		valuesToFree.push_back(VfxGraph::ValueToFree(VfxGraph::ValueToFree::kType_Bool, value));
 	}
 	else if (input.type == kVfxPlugType_Int)
 	{
-		int * value = new int();
+		int * value = constructInputLiteral<int>(*this, input, inputValue);
 		
 		*value = Parse::Int32(inputValue);
 		
 		input.connectTo(value, kVfxPlugType_Int);
-		
-		valuesToFree.push_back(VfxGraph::ValueToFree(VfxGraph::ValueToFree::kType_Int, value));
 	}
 	else if (input.type == kVfxPlugType_Float)
 	{
-		float * value = new float();
+		float * value = constructInputLiteral<float>(*this, input, inputValue);
 		
 		*value = Parse::Float(inputValue);
 		
 		input.connectTo(value, kVfxPlugType_Float);
-		
-		valuesToFree.push_back(VfxGraph::ValueToFree(VfxGraph::ValueToFree::kType_Float, value));
 	}
 	else if (input.type == kVfxPlugType_Transform)
 	{
-		VfxTransform * value = new VfxTransform();
+		VfxTransform * value = constructInputLiteral<VfxTransform>(*this, input, inputValue);
 		
 		// todo : parse inputValue
 		
 		input.connectTo(value, kVfxPlugType_Transform);
-		
-		valuesToFree.push_back(VfxGraph::ValueToFree(VfxGraph::ValueToFree::kType_Transform, value));
 	}
 	else if (input.type == kVfxPlugType_String)
 	{
-		std::string * value = new std::string();
+		std::string * value = constructInputLiteral<std::string>(*this, input, inputValue);
 		
 		*value = inputValue;
 		
 		input.connectTo(value, kVfxPlugType_String);
-		
-		valuesToFree.push_back(VfxGraph::ValueToFree(VfxGraph::ValueToFree::kType_String, value));
 	}
 	else if (input.type == kVfxPlugType_Color)
 	{
-		Color * value = new Color();
+		Color * value = constructInputLiteral<Color>(*this, input, inputValue);
 		
 		*value = Color::fromHex(inputValue.c_str());
 		
 		input.connectTo(value, kVfxPlugType_Color);
-		
-		valuesToFree.push_back(VfxGraph::ValueToFree(VfxGraph::ValueToFree::kType_Color, value));
 	}
 	else
 	{
@@ -136,9 +144,62 @@ void VfxGraph::connectToInputLiteral(VfxPlug & input, const std::string & inputV
 	}
 }
 
-void VfxGraph::tick(const float dt)
+void VfxGraph::destroyInputLiteral(VfxPlug & input)
+{
+	auto literalItr = literals.find(&input);
+	
+	if (literalItr == literals.end())
+		return;
+	
+	Literal & literal = literalItr->second;
+	
+	if (input.mem == literal.value)
+		input.disconnect();
+	
+	literal.destroy(arena, literal.value);
+	
+	literals.erase(literalItr);
+}
+
+static void addToExecutionList(VfxNodeBase * node, std::set<VfxNodeBase*> & visited, std::vector<VfxNodeBase*> & list)
+{
+	// note : visited also deduplicates predeps. the same node may be listed multiple times as a predep
+	//        when there's more than one link between two nodes
+	
+	if (visited.count(node) != 0)
+		return;
+	
+	visited.insert(node);
+	
+	for (auto predep : node->predeps)
+		addToExecutionList(predep, visited, list);
+	
+	list.push_back(node);
+}
+
+void VfxGraph::invalidateExecutionPlan()
 {
-	// use traversalId, start update at display node
+	executionPlanIsDirty = true;
+	
+	tickList.clear();
+	tickLevels.clear();
+	drawList.clear();
+	displayNode = nullptr;
+}
+
+void VfxGraph::updateExecutionPlan() const
+{
+	if (executionPlanIsDirty == false)
+		return;
+	
+	executionPlanIsDirty = false;
+	
+	tickList.clear();
+	tickLevels.clear();
+	drawList.clear();
+	displayNode = nullptr;
+	
+	std::set<VfxNodeBase*> visited;
 	
 	if (displayNodeId != kGraphNodeIdInvalid)
 	{
@@ -146,60 +207,131 @@ void VfxGraph::tick(const float dt)
 		Assert(nodeItr != nodes.end());
 		if (nodeItr != nodes.end())
 		{
-			auto node = nodeItr->second;
+			displayNode = nodeItr->second;
 			
-			VfxNodeDisplay * displayNode = static_cast<VfxNodeDisplay*>(node);
-			
-			displayNode->traverseTick(nextTickTraversalId, dt);
+			addToExecutionList(displayNode, visited, drawList);
 		}
 	}
 	
-	// process nodes that aren't connected to the display node
-
-	// todo : perhaps process unconnected nodes as islands, following predeps ?
+	// the display node and its predeps are ticked first. next come the nodes that aren't connected
+	// to the display node. these are processed as islands, following their predeps
 	
-	for (auto i : nodes)
+	tickList = drawList;
+	
+	for (auto & i : nodes)
 	{
-		VfxNodeBase * node = i.second;
+		addToExecutionList(i.second, visited, tickList);
+	}
+	
+	// group the nodes into levels. a node's level is one more than the highest level of its predeps,
+	// so nodes within the same level never depend on each other and may be ticked in any order
+	
+	std::map<VfxNodeBase*, int> nodeLevels;
+	
+	for (auto node : tickList)
+	{
+		int level = 0;
 		
-		if (node->lastTickTraversalId != nextTickTraversalId)
+		for (auto predep : node->predeps)
 		{
-			node->lastTickTraversalId = nextTickTraversalId;
+			auto levelItr = nodeLevels.find(predep);
+			
+			// note : predeps which aren't assigned a level yet are part of a cycle. ignore them
 			
-			node->tick(dt);
+			if (levelItr != nodeLevels.end())
+				level = std::max(level, levelItr->second + 1);
 		}
+		
+		nodeLevels[node] = level;
+		
+		// links may have changed. make sure pure nodes are re-evaluated
+		
+		node->markDirty();
+		
+		if (level >= tickLevels.size())
+			tickLevels.resize(level + 1);
+		
+		if (node->tickIsThreadSafe)
+			tickLevels[level].threadedNodes.push_back(node);
+		else
+			tickLevels[level].mainThreadNodes.push_back(node);
 	}
-	
-	++nextTickTraversalId;
 }
 
-void VfxGraph::draw() const
+void VfxGraph::tick(const float dt)
 {
-	// start traversal at the display node and traverse to leafs following predeps and and back up the tree again to draw
+	updateExecutionPlan();
 	
-	if (displayNodeId != kGraphNodeIdInvalid)
+	if (scheduler == nullptr || scheduler->getNumThreads() == 0)
 	{
-		auto nodeItr = nodes.find(displayNodeId);
-		Assert(nodeItr != nodes.end());
-		if (nodeItr != nodes.end())
+		for (auto node : tickList)
 		{
-			auto node = nodeItr->second;
+			node->lastTickTraversalId = nextTickTraversalId;
 			
-			VfxNodeDisplay * displayNode = static_cast<VfxNodeDisplay*>(node);
+			node->evaluate(dt);
+		}
+	}
+	else
+	{
+		for (auto & tickLevel : tickLevels)
+		{
+			// kick off the thread safe nodes on the worker threads and tick the nodes which must run on
+			// the main thread in the mean time. don't bother waking up the workers for a single node
 			
-			displayNode->traverseDraw(nextDrawTraversalId);
+			const bool useScheduler = tickLevel.threadedNodes.size() >= 2;
 			
-			const VfxImageBase * image = displayNode->getImage();
+			if (useScheduler)
+				scheduler->beginTick(&tickLevel.threadedNodes[0], tickLevel.threadedNodes.size(), dt, nextTickTraversalId);
+			else
+			{
+				for (auto node : tickLevel.threadedNodes)
+				{
+					node->lastTickTraversalId = nextTickTraversalId;
+					
+					node->evaluate(dt);
+				}
+			}
 			
-			if (image != nullptr)
+			for (auto node : tickLevel.mainThreadNodes)
 			{
-				gxSetTexture(image->getTexture());
-				pushBlend(BLEND_OPAQUE);
-				setColor(colorWhite);
-				drawRect(0, 0, GFX_SX, GFX_SY);
-				popBlend();
-				gxSetTexture(0);
+				node->lastTickTraversalId = nextTickTraversalId;
+				
+				node->evaluate(dt);
 			}
+			
+			if (useScheduler)
+				scheduler->endTick();
+		}
+	}
+	
+	++nextTickTraversalId;
+}
+
+void VfxGraph::draw() const
+{
+	// draw the nodes reachable from the display node, leafs first and the display node last
+	
+	updateExecutionPlan();
+	
+	for (auto node : drawList)
+	{
+		node->lastDrawTraversalId = nextDrawTraversalId;
+		
+		node->draw();
+	}
+	
+	if (displayNode != nullptr)
+	{
+		const VfxImageBase * image = static_cast<VfxNodeDisplay*>(displayNode)->getImage();
+		
+		if (image != nullptr)
+		{
+			gxSetTexture(image->getTexture());
+			pushBlend(BLEND_OPAQUE);
+			setColor(colorWhite);
+			drawRect(0, 0, GFX_SX, GFX_SY);
+			popBlend();
+			gxSetTexture(0);
 		}
 	}
 	
@@ -1,60 +1,70 @@
 #pragma once
 
 #include "graph.h"
+#include "vfxArena.h"
 #include <map>
 #include <string>
 #include <vector>
 
 struct VfxNodeBase;
 struct VfxPlug;
+struct VfxScheduler;
 
 struct VfxGraph
 {
-	struct ValueToFree
+	struct TickLevel
 	{
-		enum Type
-		{
-			kType_Unknown,
-			kType_Bool,
-			kType_Int,
-			kType_Float,
-			kType_Transform,
-			kType_String,
-			kType_Color
-		};
-		
-		Type type;
-		void * mem;
-		
-		ValueToFree()
-			: type(kType_Unknown)
-			, mem(nullptr)
-		{
-		}
-		
-		ValueToFree(const Type _type, void * _mem)
-			: type(_type)
-			, mem(_mem)
-		{
-		}
+		std::vector<VfxNodeBase*> threadedNodes; // nodes which may be ticked from a worker thread
+		std::vector<VfxNodeBase*> mainThreadNodes;
 	};
 	
 	std::map<GraphNodeId, VfxNodeBase*> nodes;
 	
+	std::map<GraphNodeId, std::string> nodeTypeNames; // used to match nodes when patching the graph
+	
 	GraphNodeId displayNodeId;
 	
+	// execution plan. nodes sorted topologically so each node comes after its predeps. the plan
+	// is compiled once and invalidated whenever nodes or links are added or removed
+	
+	mutable std::vector<VfxNodeBase*> tickList; // all nodes, display node island first
+	mutable std::vector<TickLevel> tickLevels; // nodes grouped by their distance to the leafs
+	mutable std::vector<VfxNodeBase*> drawList; // nodes reachable from the display node
+	mutable VfxNodeBase * displayNode;
+	mutable bool executionPlanIsDirty;
+	
 	mutable int nextTickTraversalId;
 	mutable int nextDrawTraversalId;
 	
 	Graph * graph; // todo : remove ?
 	
-	std::vector<ValueToFree> valuesToFree;
+	VfxScheduler * scheduler; // when set, nodes within the same tick level are ticked in parallel
+	
+	VfxArena arena; // owns the nodes and literal values
+	
+	// the literal values connected to inputs. a literal is destroyed when its input gets a new literal, or
+	// when the node owning the input is destroyed, so its memory is recycled during live editing
+	
+	struct Literal
+	{
+		void * value;
+		void (*destroy)(VfxArena & arena, void * value);
+		
+		std::string text; // the text the value was parsed from
+	};
+	
+	std::map<VfxPlug*, Literal> literals;
 	
 	VfxGraph();
 	~VfxGraph();
 	
 	void destroy();
+	void destroyNode(VfxNodeBase * node);
 	void connectToInputLiteral(VfxPlug & input, const std::string & inputValue);
+	void destroyInputLiteral(VfxPlug & input);
+	
+	void invalidateExecutionPlan();
+	void updateExecutionPlan() const;
 	
 	void tick(const float dt);
 	void draw() const;
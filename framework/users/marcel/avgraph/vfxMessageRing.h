@@ -0,0 +1,141 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+/*
+
+VfxMessageRing is a bounded queue of preallocated message slots, used to pass messages from a network
+thread to the node which consumes them on the main thread, without allocating memory or taking locks.
+
+there is a single producer and a single consumer. when the ring is full, the producer drops the oldest
+message to make room for the new one. each slot carries a sequence number, which lets the producer claim
+the oldest message the same way the consumer does, so the two never access the same slot at once.
+
+usage:
+	
+	// producer thread
+	
+	Message * message = ring.beginPush();
+	
+	if (message != nullptr)
+	{
+		fill(*message);
+		
+		ring.endPush();
+	}
+	
+	// consumer thread
+	
+	Message message;
+	
+	while (ring.pop(message))
+		handle(message);
+
+*/
+
+template <typename T, int kCapacity>
+struct VfxMessageRing
+{
+	static_assert(kCapacity >= 2 && (kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+	
+	// when the consumer is in the middle of reading the slot the producer wants to write, the producer
+	// drops another message and tries again. after this many attempts, the new message is dropped instead
+	
+	static const int kMaxPushAttempts = 4;
+	
+	struct Slot
+	{
+		SDL_atomic_t sequence;
+		T value;
+	};
+	
+	Slot slots[kCapacity];
+	
+	unsigned int pushPosition; // only accessed by the producer
+	SDL_atomic_t popPosition;
+	
+	SDL_atomic_t numDropped;
+	
+	VfxMessageRing()
+		: pushPosition(0)
+	{
+		for (int i = 0; i < kCapacity; ++i)
+			SDL_AtomicSet(&slots[i].sequence, i);
+		
+		SDL_AtomicSet(&popPosition, 0);
+		SDL_AtomicSet(&numDropped, 0);
+	}
+	
+	T * beginPush()
+	{
+		for (int i = 0; i < kMaxPushAttempts; ++i)
+		{
+			Slot & slot = slots[pushPosition & (kCapacity - 1)];
+			
+			if ((unsigned int)SDL_AtomicGet(&slot.sequence) == pushPosition)
+				return &slot.value;
+			
+			// the ring is full. drop the oldest message
+			
+			if (claim(nullptr))
+				SDL_AtomicIncRef(&numDropped);
+		}
+		
+		SDL_AtomicIncRef(&numDropped);
+		
+		return nullptr;
+	}
+	
+	void endPush()
+	{
+		Slot & slot = slots[pushPosition & (kCapacity - 1)];
+		
+		SDL_AtomicSet(&slot.sequence, pushPosition + 1);
+		
+		pushPosition++;
+	}
+	
+	bool pop(T & value)
+	{
+		return claim(&value);
+	}
+	
+	int getNumDropped()
+	{
+		return SDL_AtomicGet(&numDropped);
+	}
+	
+	// claim the oldest message and hand its slot back to the producer. value may be null to drop it
+	
+	bool claim(T * value)
+	{
+		for (;;)
+		{
+			const unsigned int position = SDL_AtomicGet(&popPosition);
+			
+			Slot & slot = slots[position & (kCapacity - 1)];
+			
+			const int delta = int((unsigned int)SDL_AtomicGet(&slot.sequence) - (position + 1));
+			
+			if (delta < 0)
+			{
+				// the slot hasn't been written yet. the ring is empty
+				
+				return false;
+			}
+			else if (delta == 0 && SDL_AtomicCAS(&popPosition, position, position + 1))
+			{
+				if (value != nullptr)
+					*value = slot.value;
+				
+				// hand the slot back to the producer
+				
+				SDL_AtomicSet(&slot.sequence, position + kCapacity);
+				
+				return true;
+			}
+			
+			// the other side claimed the slot before us. try again with the next position
+		}
+	}
+};
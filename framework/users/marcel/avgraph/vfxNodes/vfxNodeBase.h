@@ -16,12 +16,47 @@ struct VfxTransform
 	Mat4x4 matrix;
 };
 
+struct VfxFloatArray
+{
+	// fixed capacity array of floats. used to pass around vectors of values (joint positions, etc)
+	// without having to format and parse them as strings
+	
+	static const int kMaxElements = 512;
+	
+	float elements[kMaxElements];
+	int numElements;
+	
+	VfxFloatArray()
+		: numElements(0)
+	{
+	}
+	
+	void set(const float * values, const int numValues)
+	{
+		numElements = numValues < kMaxElements ? numValues : kMaxElements;
+		
+		memcpy(elements, values, numElements * sizeof(float));
+	}
+	
+	int size() const
+	{
+		return numElements;
+	}
+	
+	float operator[](const int index) const
+	{
+		Assert(index >= 0 && index < numElements);
+		return elements[index];
+	}
+};
+
 enum VfxTriggerDataType
 {
 	kVfxTriggerDataType_None,
 	kVfxTriggerDataType_Bool,
 	kVfxTriggerDataType_Int,
-	kVfxTriggerDataType_Float
+	kVfxTriggerDataType_Float,
+	kVfxTriggerDataType_FloatArray
 };
 
 struct VfxTriggerData
@@ -33,6 +68,7 @@ struct VfxTriggerData
 		bool boolValue;
 		int intValue;
 		float floatValue;
+		const VfxFloatArray * floatArrayValue;
 		uint8_t mem[8];
 	};
 	
@@ -60,6 +96,12 @@ struct VfxTriggerData
 		floatValue = value;
 	}
 	
+	void setFloatArray(const VfxFloatArray * value)
+	{
+		type = kVfxTriggerDataType_FloatArray;
+		floatArrayValue = value;
+	}
+	
 	bool asBool() const
 	{
 		switch (type)
@@ -72,6 +114,8 @@ struct VfxTriggerData
 			return intValue != 0;
 		case kVfxTriggerDataType_Float:
 			return floatValue != 0.f;
+		case kVfxTriggerDataType_FloatArray:
+			return floatArrayValue->size() != 0;
 		}
 	}
 	
@@ -87,6 +131,8 @@ struct VfxTriggerData
 			return intValue;
 		case kVfxTriggerDataType_Float:
 			return std::round(floatValue);
+		case kVfxTriggerDataType_FloatArray:
+			return floatArrayValue->size();
 		}
 	}
 	
@@ -102,6 +148,8 @@ struct VfxTriggerData
 			return float(intValue);
 		case kVfxTriggerDataType_Float:
 			return floatValue;
+		case kVfxTriggerDataType_FloatArray:
+			return float(floatArrayValue->size());
 		}
 	}
 };
@@ -166,19 +214,30 @@ enum VfxPlugType
 	kVfxPlugType_Color,
 	kVfxPlugType_Image,
 	kVfxPlugType_Surface,
-	kVfxPlugType_Trigger
+	kVfxPlugType_Trigger,
+	kVfxPlugType_FloatArray
 };
 
 struct VfxPlug
 {
 	VfxPlugType type;
 	bool isValid;
+	bool isInitInput; // set for inputs which are only read by init. nodes are recreated when the value changes
 	void * mem;
 	
+	// version counters used to detect changes. outputs and literal inputs own their version. inputs
+	// connected to an output refer to the output's version through memVersion
+	
+	int version;
+	int * memVersion;
+	
 	VfxPlug()
 		: type(kVfxPlugType_None)
 		, isValid(true)
+		, isInitInput(false)
 		, mem(nullptr)
+		, version(0)
+		, memVersion(nullptr)
 	{
 	}
 	
@@ -191,6 +250,7 @@ struct VfxPlug
 		else
 		{
 			mem = dst.mem;
+			memVersion = &dst.version;
 		}
 	}
 	
@@ -203,12 +263,18 @@ struct VfxPlug
 		else
 		{
 			mem = dstMem;
+			memVersion = &version;
+			
+			++version;
 		}
 	}
 	
 	void disconnect()
 	{
 		mem = nullptr;
+		memVersion = nullptr;
+		
+		++version;
 	}
 	
 	bool isConnected() const
@@ -216,6 +282,19 @@ struct VfxPlug
 		return mem != nullptr;
 	}
 	
+	int getVersion() const
+	{
+		return memVersion ? *memVersion : version;
+	}
+	
+	void markChanged()
+	{
+		if (memVersion)
+			++*memVersion;
+		else
+			++version;
+	}
+	
 	bool getBool() const
 	{
 		if (type == kVfxPlugType_Trigger)
@@ -276,6 +355,12 @@ struct VfxPlug
 		return *((VfxTriggerData*)mem);
 	}
 	
+	const VfxFloatArray & getFloatArray() const
+	{
+		Assert(type == kVfxPlugType_FloatArray);
+		return *((VfxFloatArray*)mem);
+	}
+	
 	//
 	
 	bool & getRwBool()
@@ -343,6 +428,12 @@ struct VfxNodeBase
 	
 	bool isPassthrough;
 	
+	bool tickIsThreadSafe; // set by nodes whose tick doesn't touch GL or other main thread only state
+	bool tickIsPure; // set by nodes whose outputs only depend on their inputs. these are ticked when an input changes
+	
+	bool isDirty; // pure nodes are ticked when dirty, regardless of their inputs. set initially and by markDirty
+	std::vector<int> lastInputVersions;
+	
 	VfxNodeBase()
 		: inputs()
 		, outputs()
@@ -352,6 +443,10 @@ struct VfxNodeBase
 		, lastDrawTraversalId(-1)
 		, editorIsTriggered(false)
 		, isPassthrough(false)
+		, tickIsThreadSafe(false)
+		, tickIsPure(false)
+		, isDirty(true)
+		, lastInputVersions()
 	{
 	}
 	
@@ -359,32 +454,46 @@ struct VfxNodeBase
 	{
 	}
 	
-	void traverseTick(const int traversalId, const float dt)
+	void evaluate(const float dt)
 	{
-		Assert(lastTickTraversalId != traversalId);
-		lastTickTraversalId = traversalId;
-		
-		for (auto predep : predeps)
+		if (tickIsPure)
 		{
-			if (predep->lastTickTraversalId != traversalId)
-				predep->traverseTick(traversalId, dt);
+			bool hasChanged = isDirty;
+			
+			isDirty = false;
+			
+			if (lastInputVersions.size() != inputs.size())
+			{
+				lastInputVersions.resize(inputs.size());
+				hasChanged = true;
+			}
+			
+			for (size_t i = 0; i < inputs.size(); ++i)
+			{
+				const int version = inputs[i].getVersion();
+				
+				if (version != lastInputVersions[i])
+				{
+					lastInputVersions[i] = version;
+					hasChanged = true;
+				}
+			}
+			
+			if (hasChanged == false)
+				return;
 		}
 		
 		tick(dt);
+		
+		for (auto & output : outputs)
+			++output.version;
 	}
 	
-	void traverseDraw(const int traversalId)
+	void markDirty()
 	{
-		Assert(lastDrawTraversalId != traversalId);
-		lastDrawTraversalId = traversalId;
-		
-		for (auto predep : predeps)
-		{
-			if (predep->lastDrawTraversalId != traversalId)
-				predep->traverseDraw(traversalId);
-		}
+		// force the next evaluate to tick the node
 		
-		draw();
+		isDirty = true;
 	}
 	
 	void trigger(const int outputSocketIndex)
@@ -428,6 +537,18 @@ struct VfxNodeBase
 		}
 	}
 	
+	// adds an input which is only read by init. changing its value recreates the node, so it's initialized again
+	
+	void addInitInput(const int index, VfxPlugType type)
+	{
+		addInput(index, type);
+		
+		if (index >= 0 && index < inputs.size())
+		{
+			inputs[index].isInitInput = true;
+		}
+	}
+	
 	void addOutput(const int index, VfxPlugType type, void * mem)
 	{
 		Assert(index >= 0 && index < outputs.size());
@@ -524,6 +645,16 @@ struct VfxNodeBase
 			return plug->getString().c_str();
 	}
 	
+	const VfxFloatArray * getInputFloatArray(const int index, const VfxFloatArray * defaultValue) const
+	{
+		const VfxPlug * plug = tryGetInput(index);
+		
+		if (plug == nullptr || !plug->isConnected())
+			return defaultValue;
+		else
+			return &plug->getFloatArray();
+	}
+	
 	const VfxImageBase * getInputImage(const int index, const VfxImageBase * defaultValue) const
 	{
 		const VfxPlug * plug = tryGetInput(index);
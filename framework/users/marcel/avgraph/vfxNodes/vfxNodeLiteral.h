@@ -18,6 +18,8 @@ struct VfxNodeBoolLiteral : VfxNodeBase
 	{
 		resizeSockets(0, kOutput_COUNT);
 		addOutput(kOutput_Value, kVfxPlugType_Bool, &value);
+		
+		tickIsPure = true;
 	}
 	
 	virtual void initSelf(const GraphNode & node) override
@@ -42,6 +44,8 @@ struct VfxNodeIntLiteral : VfxNodeBase
 	{
 		resizeSockets(0, kOutput_COUNT);
 		addOutput(kOutput_Value, kVfxPlugType_Int, &value);
+		
+		tickIsPure = true;
 	}
 	
 	virtual void initSelf(const GraphNode & node) override
@@ -66,6 +70,8 @@ struct VfxNodeFloatLiteral : VfxNodeBase
 	{
 		resizeSockets(0, kOutput_COUNT);
 		addOutput(kOutput_Value, kVfxPlugType_Float, &value);
+		
+		tickIsPure = true;
 	}
 	
 	virtual void initSelf(const GraphNode & node) override
@@ -90,6 +96,8 @@ struct VfxNodeTransformLiteral : VfxNodeBase
 	{
 		resizeSockets(0, kOutput_COUNT);
 		addOutput(kOutput_Value, kVfxPlugType_Transform, &value);
+		
+		tickIsPure = true;
 	}
 	
 	virtual void initSelf(const GraphNode & node) override
@@ -114,6 +122,8 @@ struct VfxNodeStringLiteral : VfxNodeBase
 	{
 		resizeSockets(0, kOutput_COUNT);
 		addOutput(kOutput_Value, kVfxPlugType_String, &value);
+		
+		tickIsPure = true;
 	}
 	
 	virtual void initSelf(const GraphNode & node) override
@@ -138,6 +148,8 @@ struct VfxNodeColorLiteral : VfxNodeBase
 	{
 		resizeSockets(0, kOutput_COUNT);
 		addOutput(kOutput_Value, kVfxPlugType_Color, &value);
+		
+		tickIsPure = true;
 	}
 	
 	virtual void initSelf(const GraphNode & node) override
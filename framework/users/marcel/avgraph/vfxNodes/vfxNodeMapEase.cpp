@@ -11,6 +11,9 @@ VfxNodeMapEase::VfxNodeMapEase()
 	addInput(kInput_Param, kVfxPlugType_Float);
 	addInput(kInput_Mirror, kVfxPlugType_Bool);
 	addOutput(kOutput_Result, kVfxPlugType_Float, &outputValue);
+	
+	tickIsThreadSafe = true;
+	tickIsPure = true;
 }
 
 void VfxNodeMapEase::tick(const float dt)
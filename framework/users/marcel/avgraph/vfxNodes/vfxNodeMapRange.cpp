@@ -13,6 +13,9 @@ VfxNodeMapRange::VfxNodeMapRange()
 	addInput(kInput_OutCurvePow, kVfxPlugType_Float);
 	addInput(kInput_Clamp, kVfxPlugType_Bool);
 	addOutput(kOutput_Value, kVfxPlugType_Float, &outputValue);
+	
+	tickIsThreadSafe = true;
+	tickIsPure = true;
 }
 
 void VfxNodeMapRange::tick(const float dt)
@@ -56,6 +56,9 @@ struct VfxNodeMath : VfxNodeBase
 		addInput(kInput_A, kVfxPlugType_Float);
 		addInput(kInput_B, kVfxPlugType_Float);
 		addOutput(kOutput_R, kVfxPlugType_Float, &result);
+		
+		tickIsThreadSafe = true;
+		tickIsPure = true;
 	}
 	
 	virtual void tick(const float dt) override
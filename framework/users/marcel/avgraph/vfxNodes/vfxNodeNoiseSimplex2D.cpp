@@ -12,6 +12,9 @@ VfxNodeNoiseSimplex2D::VfxNodeNoiseSimplex2D()
 	addInput(kInput_Persistence, kVfxPlugType_Float);
 	addInput(kInput_Scale, kVfxPlugType_Float);
 	addOutput(kOutput_Value, kVfxPlugType_Float, &outputValue);
+	
+	tickIsThreadSafe = true;
+	tickIsPure = true;
 }
 
 void VfxNodeNoiseSimplex2D::tick(const float dt)
@@ -1,42 +1,42 @@
 #include "vfxNodeOsc.h"
+#include "oscRouteTable.h"
+#include "vfxMessageRing.h"
 
 #include "ip/UdpSocket.h"
 #include "osc/OscOutboundPacketStream.h"
 #include "osc/OscPacketListener.h"
 
-#include <list>
+enum OscRoute
+{
+	kOscRoute_Event
+};
 
 struct OscMessage
 {
 	OscMessage()
-		: event()
-		, str()
+		: routeId(OscRouteTable::kInvalidRouteId)
 	{
 		memset(param, 0, sizeof(param));
 	}
 	
-	std::string event;
+	int routeId;
 	float param[4];
-	std::string str;
 };
 
-class MyOscPacketListener : public osc::OscPacketListener
+class MyOscPacketListener : public RoutingOscPacketListener<MyOscPacketListener>
 {
 public:
-	SDL_mutex * oscMessageMtx;
-	std::list<OscMessage> oscMessages;
+	static const int kMaxMessages = 256;
 	
-	MyOscPacketListener()
-		: oscMessageMtx(nullptr)
-		, oscMessages()
-	{
-		oscMessageMtx = SDL_CreateMutex();
-	}
+	VfxMessageRing<OscMessage, kMaxMessages> oscMessages;
 	
-	~MyOscPacketListener()
+	int numDroppedReported;
+	
+	MyOscPacketListener()
+		: oscMessages()
+		, numDroppedReported(0)
 	{
-		SDL_DestroyMutex(oscMessageMtx);
-		oscMessageMtx = nullptr;
+		RegisterRoute("/event", kOscRoute_Event, &MyOscPacketListener::handleEvent);
 	}
 	
 protected:
@@ -46,41 +46,24 @@ protected:
 
 		osc::OscPacketListener::ProcessBundle(b, remoteEndpoint);
 	}
-
-	virtual void ProcessMessage(const osc::ReceivedMessage & m, const IpEndpointName & remoteEndpoint) override
+	
+	virtual void ProcessUnroutedMessage(const osc::ReceivedMessage & m, const IpEndpointName & remoteEndpoint) override
 	{
-		try
-		{
-			//logDebug("ProcessMessage");
-
-			osc::ReceivedMessageArgumentStream args = m.ArgumentStream();
-
-			OscMessage message;
-
-			if (strcmp(m.AddressPattern(), "/event") == 0)
-			{
-				message.event = m.AddressPattern();
-				message.str = std::string(m.AddressPattern()).substr(1);
-			}
-			else
-			{
-				logWarning("unknown message type: %s", m.AddressPattern());
-			}
-
-			if (!message.event.empty())
-			{
-				SDL_LockMutex(oscMessageMtx);
-				{
-					logDebug("enqueue OSC message. event=%s", message.event.c_str());
-
-					oscMessages.push_back(message);
-				}
-				SDL_UnlockMutex(oscMessageMtx);
-			}
-		}
-		catch (osc::Exception & e)
+		logWarning("unknown message type: %s", m.AddressPattern());
+	}
+	
+	void handleEvent(const osc::ReceivedMessage & m, const int routeId, const IpEndpointName & remoteEndpoint)
+	{
+		OscMessage * message = oscMessages.beginPush();
+		
+		if (message != nullptr)
 		{
-			logError("error while parsing message: %s: %s", m.AddressPattern(), e.what());
+			logDebug("enqueue OSC message. event=%s", m.AddressPattern());
+			
+			message->routeId = routeId;
+			memset(message->param, 0, sizeof(message->param));
+			
+			oscMessages.endPush();
 		}
 	}
 };
@@ -93,8 +76,8 @@ VfxNodeOsc::VfxNodeOsc()
 	, oscMessageThread(nullptr)
 {
 	resizeSockets(kInput_COUNT, kOutput_COUNT);
-	addInput(kInput_Port, kVfxPlugType_Int);
-	addInput(kInput_IpAddress, kVfxPlugType_String);
+	addInitInput(kInput_Port, kVfxPlugType_Int);
+	addInitInput(kInput_IpAddress, kVfxPlugType_String);
 	addOutput(kOutput_Trigger, kVfxPlugType_Trigger, &eventId);
 }
 
@@ -163,25 +146,24 @@ void VfxNodeOsc::init(const GraphNode & node)
 void VfxNodeOsc::tick(const float dt)
 {
 	// update network input
-
-	SDL_LockMutex(oscPacketListener->oscMessageMtx);
+	
+	OscMessage message;
+	
+	while (oscPacketListener->oscMessages.pop(message))
 	{
-		while (!oscPacketListener->oscMessages.empty())
-		{
-			const OscMessage message = oscPacketListener->oscMessages.front();
-			
-			oscPacketListener->oscMessages.pop_front();
-			
-			SDL_UnlockMutex(oscPacketListener->oscMessageMtx);
-			{
-				// todo : store OSC values in trigger mem
-				
-				trigger(kOutput_Trigger);
-			}
-			SDL_LockMutex(oscPacketListener->oscMessageMtx);
-		}
+		// todo : store OSC values in trigger mem
+		
+		trigger(kOutput_Trigger);
+	}
+	
+	const int numDropped = oscPacketListener->oscMessages.getNumDropped();
+	
+	if (numDropped != oscPacketListener->numDroppedReported)
+	{
+		logWarning("OSC message queue overflow. dropped %d messages in total", numDropped);
+		
+		oscPacketListener->numDroppedReported = numDropped;
 	}
-	SDL_UnlockMutex(oscPacketListener->oscMessageMtx);
 }
 
 int VfxNodeOsc::executeOscThread(void * data)
@@ -7,6 +7,8 @@ VfxNodeOscSine::VfxNodeOscSine()
 	resizeSockets(kInput_COUNT, kOutput_COUNT);
 	addInput(kInput_Frequency, kVfxPlugType_Float);
 	addOutput(kOutput_Value, kVfxPlugType_Float, &value);
+	
+	tickIsThreadSafe = true;
 }
 
 void VfxNodeOscSine::tick(const float dt)
@@ -27,6 +29,8 @@ VfxNodeOscSaw::VfxNodeOscSaw()
 	resizeSockets(kInput_COUNT, kOutput_COUNT);
 	addInput(kInput_Frequency, kVfxPlugType_Float);
 	addOutput(kOutput_Value, kVfxPlugType_Float, &value);
+	
+	tickIsThreadSafe = true;
 }
 
 void VfxNodeOscSaw::tick(const float dt)
@@ -47,6 +51,8 @@ VfxNodeOscTriangle::VfxNodeOscTriangle()
 	resizeSockets(kInput_COUNT, kOutput_COUNT);
 	addInput(kInput_Frequency, kVfxPlugType_Float);
 	addOutput(kOutput_Value, kVfxPlugType_Float, &value);
+	
+	tickIsThreadSafe = true;
 }
 
 void VfxNodeOscTriangle::tick(const float dt)
@@ -67,6 +73,8 @@ VfxNodeOscSquare::VfxNodeOscSquare()
 	resizeSockets(kInput_COUNT, kOutput_COUNT);
 	addInput(kInput_Frequency, kVfxPlugType_Float);
 	addOutput(kOutput_Value, kVfxPlugType_Float, &value);
+	
+	tickIsThreadSafe = true;
 }
 
 void VfxNodeOscSquare::tick(const float dt)
@@ -12,7 +12,7 @@ VfxNodeVideo::VfxNodeVideo()
 	mediaPlayer = new MediaPlayer();
 	
 	resizeSockets(kInput_COUNT, kOutput_COUNT);
-	addInput(kInput_Source, kVfxPlugType_String);
+	addInitInput(kInput_Source, kVfxPlugType_String);
 	addInput(kInput_Transform, kVfxPlugType_Transform);
 	addOutput(kOutput_Image, kVfxPlugType_Image, image);
 	
@@ -0,0 +1,261 @@
+#include "framework.h"
+#include "vfxScheduler.h"
+#include "vfxNodes/vfxNodeBase.h"
+#include <algorithm>
+
+bool VfxScheduler::Job::hasWork() const
+{
+	for (int i = 0; i < numRanges; ++i)
+	{
+		Range & range = const_cast<Range&>(ranges[i]);
+		
+		if (SDL_AtomicGet(&range.next) < range.end)
+			return true;
+	}
+	
+	return false;
+}
+
+VfxScheduler::VfxScheduler()
+	: threads()
+	, mutex(nullptr)
+	, workCond(nullptr)
+	, doneCond(nullptr)
+	, stopThreads(false)
+	, nextThreadIndex()
+	, jobs()
+	, tickJob()
+	, nodes(nullptr)
+	, dt(0.f)
+	, traversalId(-1)
+{
+}
+
+VfxScheduler::~VfxScheduler()
+{
+	shut();
+}
+
+void VfxScheduler::init(const int numThreads)
+{
+	shut();
+	
+	//
+	
+	mutex = SDL_CreateMutex();
+	workCond = SDL_CreateCond();
+	doneCond = SDL_CreateCond();
+	
+	stopThreads = false;
+	
+	SDL_AtomicSet(&nextThreadIndex, 0);
+	
+	for (int i = 0; i < numThreads; ++i)
+	{
+		SDL_Thread * thread = SDL_CreateThread(threadMain, "VfxScheduler Thread", this);
+		
+		threads.push_back(thread);
+	}
+}
+
+void VfxScheduler::shut()
+{
+	if (!threads.empty())
+	{
+		SDL_LockMutex(mutex);
+		{
+			stopThreads = true;
+			
+			SDL_CondBroadcast(workCond);
+		}
+		SDL_UnlockMutex(mutex);
+		
+		for (auto thread : threads)
+			SDL_WaitThread(thread, nullptr);
+		
+		threads.clear();
+	}
+	
+	Assert(jobs.empty());
+	
+	if (workCond != nullptr)
+	{
+		SDL_DestroyCond(workCond);
+		workCond = nullptr;
+	}
+	
+	if (doneCond != nullptr)
+	{
+		SDL_DestroyCond(doneCond);
+		doneCond = nullptr;
+	}
+	
+	if (mutex != nullptr)
+	{
+		SDL_DestroyMutex(mutex);
+		mutex = nullptr;
+	}
+	
+	stopThreads = false;
+}
+
+void VfxScheduler::beginJob(Job & job, VfxJobFunction function, void * data, const int numItems)
+{
+	// note : init must have been called, even when running without worker threads, as the mutex is needed to start jobs
+	
+	Assert(mutex != nullptr);
+	
+	job.function = function;
+	job.data = data;
+	job.numWorkers = 0;
+	
+	// split the items into one range per participant. the last range belongs to the calling thread
+	
+	job.numRanges = int(threads.size()) + 1 < kMaxRanges ? int(threads.size()) + 1 : kMaxRanges;
+	
+	for (int i = 0; i < job.numRanges; ++i)
+	{
+		Range & range = job.ranges[i];
+		
+		SDL_AtomicSet(&range.next, numItems * (i + 0) / job.numRanges);
+		range.end = numItems * (i + 1) / job.numRanges;
+	}
+	
+	if (!threads.empty())
+	{
+		SDL_LockMutex(mutex);
+		{
+			jobs.push_back(&job);
+			
+			SDL_CondBroadcast(workCond);
+		}
+		SDL_UnlockMutex(mutex);
+	}
+}
+
+void VfxScheduler::endJob(Job & job)
+{
+	// help out processing the items. once we're done all items have been picked up, so we only need to wait
+	// for the worker threads to finish the items they're processing
+	
+	process(job, job.numRanges - 1);
+	
+	if (!threads.empty())
+	{
+		SDL_LockMutex(mutex);
+		{
+			auto i = std::find(jobs.begin(), jobs.end(), &job);
+			
+			Assert(i != jobs.end());
+			jobs.erase(i);
+			
+			while (job.numWorkers != 0)
+				SDL_CondWait(doneCond, mutex);
+		}
+		SDL_UnlockMutex(mutex);
+	}
+	
+	job.function = nullptr;
+	job.data = nullptr;
+}
+
+void VfxScheduler::beginTick(VfxNodeBase * const * _nodes, const int numNodes, const float _dt, const int _traversalId)
+{
+	nodes = _nodes;
+	dt = _dt;
+	traversalId = _traversalId;
+	
+	beginJob(tickJob, tickNode, this, numNodes);
+}
+
+void VfxScheduler::endTick()
+{
+	endJob(tickJob);
+	
+	nodes = nullptr;
+}
+
+void VfxScheduler::process(Job & job, const int rangeIndex)
+{
+	const int numRanges = job.numRanges;
+	
+	for (int i = 0; i < numRanges; ++i)
+	{
+		// start with our own range, and steal from the other ranges once it's empty
+		
+		Range & range = job.ranges[(rangeIndex + i) % numRanges];
+		
+		for (;;)
+		{
+			const int index = SDL_AtomicAdd(&range.next, 1);
+			
+			if (index >= range.end)
+				break;
+			
+			job.function(job.data, index);
+		}
+	}
+}
+
+void VfxScheduler::tickNode(void * data, const int index)
+{
+	VfxScheduler * self = (VfxScheduler*)data;
+	
+	VfxNodeBase * node = self->nodes[index];
+	
+	node->lastTickTraversalId = self->traversalId;
+	
+	node->evaluate(self->dt);
+}
+
+int VfxScheduler::threadMain(void * data)
+{
+	VfxScheduler * self = (VfxScheduler*)data;
+	
+	const int threadIndex = SDL_AtomicAdd(&self->nextThreadIndex, 1);
+	
+	SDL_LockMutex(self->mutex);
+	
+	while (!self->stopThreads)
+	{
+		// join the innermost job with items left. nested jobs are started by threads processing an item of an
+		// outer job, so finishing them first unblocks the outer job sooner
+		
+		Job * job = nullptr;
+		
+		for (auto i = self->jobs.rbegin(); i != self->jobs.rend(); ++i)
+		{
+			if ((*i)->hasWork())
+			{
+				job = *i;
+				break;
+			}
+		}
+		
+		if (job == nullptr)
+		{
+			SDL_CondWait(self->workCond, self->mutex);
+			continue;
+		}
+		
+		job->numWorkers++;
+		
+		SDL_UnlockMutex(self->mutex);
+		{
+			// note : the thread index is only used to pick a range to start with. any thread may end up
+			//        processing any range
+			
+			self->process(*job, threadIndex % job->numRanges);
+		}
+		SDL_LockMutex(self->mutex);
+		
+		job->numWorkers--;
+		
+		if (job->numWorkers == 0)
+			SDL_CondBroadcast(self->doneCond);
+	}
+	
+	SDL_UnlockMutex(self->mutex);
+	
+	return 0;
+}
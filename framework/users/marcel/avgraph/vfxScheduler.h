@@ -0,0 +1,100 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+struct VfxNodeBase;
+
+/*
+
+VfxScheduler ticks a set of independent nodes in parallel. the set is split into equal ranges, one
+for each worker thread plus one for the calling thread. each participant first drains its own range
+and then steals from the ranges of the other participants, until all nodes have been ticked.
+
+nodes passed to tick must not depend on each other. VfxGraph ensures this by only passing in nodes
+from the same level of the execution plan.
+
+besides ticking nodes, the scheduler can run any job which consists of independent work items, using
+parallelFor or beginJob/endJob. jobs may be nested: a node ticked by the scheduler may run a job of its
+own on the same scheduler. idle worker threads join the most recently started job, and the thread which
+started a job processes its items too, so a nested job makes progress even when all of the workers are
+busy.
+
+*/
+
+typedef void (*VfxJobFunction)(void * data, const int index);
+
+struct VfxScheduler
+{
+	static const int kMaxRanges = 64;
+	
+	struct Range
+	{
+		SDL_atomic_t next;
+		int end;
+	};
+	
+	struct Job
+	{
+		VfxJobFunction function;
+		void * data;
+		
+		Range ranges[kMaxRanges];
+		int numRanges;
+		
+		int numWorkers; // the number of worker threads processing the job. protected by the scheduler mutex
+		
+		bool hasWork() const;
+	};
+	
+	std::vector<SDL_Thread*> threads;
+	
+	SDL_mutex * mutex;
+	SDL_cond * workCond; // signalled when a job is started
+	SDL_cond * doneCond; // signalled when a worker thread is done processing a job
+	
+	bool stopThreads;
+	
+	SDL_atomic_t nextThreadIndex;
+	
+	std::vector<Job*> jobs; // the jobs which are running, innermost last. protected by the mutex
+	
+	// the current tick
+	
+	Job tickJob;
+	
+	VfxNodeBase * const * nodes;
+	float dt;
+	int traversalId;
+	
+	VfxScheduler();
+	~VfxScheduler();
+	
+	void init(const int numThreads);
+	void shut();
+	
+	int getNumThreads() const
+	{
+		return threads.size();
+	}
+	
+	void beginJob(Job & job, VfxJobFunction function, void * data, const int numItems);
+	void endJob(Job & job);
+	
+	void parallelFor(VfxJobFunction function, void * data, const int numItems)
+	{
+		Job job;
+		
+		beginJob(job, function, data, numItems);
+		endJob(job);
+	}
+	
+	void beginTick(VfxNodeBase * const * nodes, const int numNodes, const float dt, const int traversalId);
+	void endTick();
+	
+	void process(Job & job, const int rangeIndex);
+	
+	static void tickNode(void * data, const int index);
+	
+	static int threadMain(void * data);
+};
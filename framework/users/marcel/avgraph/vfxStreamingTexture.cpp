@@ -0,0 +1,174 @@
+#include "vfxStreamingTexture.h"
+
+static int getBytesPerPixel(const GLenum uploadFormat, const GLenum uploadElementType)
+{
+	const int numChannels =
+		uploadFormat == GL_RED ? 1 :
+		uploadFormat == GL_RG ? 2 :
+		uploadFormat == GL_RGB ? 3 :
+		uploadFormat == GL_RGBA ? 4 :
+		0;
+	
+	const int elementSize =
+		uploadElementType == GL_UNSIGNED_BYTE ? 1 :
+		uploadElementType == GL_UNSIGNED_SHORT ? 2 :
+		uploadElementType == GL_FLOAT ? 4 :
+		0;
+	
+	Assert(numChannels != 0 && elementSize != 0);
+	
+	return numChannels * elementSize;
+}
+
+VfxStreamingTexture::VfxStreamingTexture()
+	: texture(0)
+	, buffers()
+	, nextBufferIndex(0)
+	, sx(0)
+	, sy(0)
+	, bytesPerPixel(0)
+	, uploadFormat(GL_RED)
+	, uploadElementType(GL_UNSIGNED_BYTE)
+	, isMapped(false)
+{
+}
+
+VfxStreamingTexture::~VfxStreamingTexture()
+{
+	free();
+}
+
+bool VfxStreamingTexture::allocate(const int _sx, const int _sy, const GLenum internalFormat, const GLenum _uploadFormat, const GLenum _uploadElementType, const bool filter, const bool clamp)
+{
+	free();
+	
+	sx = _sx;
+	sy = _sy;
+	bytesPerPixel = getBytesPerPixel(_uploadFormat, _uploadElementType);
+	uploadFormat = _uploadFormat;
+	uploadElementType = _uploadElementType;
+	
+	checkErrorGL();
+	
+	GLuint restoreTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, reinterpret_cast<GLint*>(&restoreTexture));
+	
+	glGenTextures(1, &texture);
+	
+	if (texture == 0)
+	{
+		logError("failed to create streaming texture");
+		return false;
+	}
+	
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, sx, sy, 0, uploadFormat, uploadElementType, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter ? GL_LINEAR : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter ? GL_LINEAR : GL_NEAREST);
+	checkErrorGL();
+	
+	glBindTexture(GL_TEXTURE_2D, restoreTexture);
+	
+	glGenBuffers(kNumBuffers, buffers);
+	
+	for (int i = 0; i < kNumBuffers; ++i)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[i]);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, getUpdateSize(), nullptr, GL_STREAM_DRAW);
+	}
+	
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	checkErrorGL();
+	
+	return true;
+}
+
+void VfxStreamingTexture::free()
+{
+	Assert(!isMapped);
+	
+	if (buffers[0] != 0)
+	{
+		glDeleteBuffers(kNumBuffers, buffers);
+		memset(buffers, 0, sizeof(buffers));
+	}
+	
+	if (texture != 0)
+	{
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+	
+	nextBufferIndex = 0;
+}
+
+void VfxStreamingTexture::setSwizzle(const GLint r, const GLint g, const GLint b, const GLint a)
+{
+	GLuint restoreTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, reinterpret_cast<GLint*>(&restoreTexture));
+	
+	glBindTexture(GL_TEXTURE_2D, texture);
+	GLint swizzleMask[4] = { r, g, b, a };
+	glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
+	
+	glBindTexture(GL_TEXTURE_2D, restoreTexture);
+	checkErrorGL();
+}
+
+void * VfxStreamingTexture::beginUpdate()
+{
+	Assert(!isMapped);
+	
+	if (texture == 0)
+		return nullptr;
+	
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[nextBufferIndex]);
+	
+	// orphan the buffer, so the driver hands out new storage when the GPU is still reading from the old one
+	
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, getUpdateSize(), nullptr, GL_STREAM_DRAW);
+	
+	void * pixels = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, getUpdateSize(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	checkErrorGL();
+	
+	isMapped = pixels != nullptr;
+	
+	return pixels;
+}
+
+void VfxStreamingTexture::endUpdate()
+{
+	Assert(isMapped);
+	
+	GLuint restoreTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, reinterpret_cast<GLint*>(&restoreTexture));
+	GLint restoreUnpackAlignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &restoreUnpackAlignment);
+	GLint restoreUnpackRowLength;
+	glGetIntegerv(GL_UNPACK_ROW_LENGTH, &restoreUnpackRowLength);
+	
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[nextBufferIndex]);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	isMapped = false;
+	
+	// copy the pixels from the buffer into the texture. the pointer passed to glTexSubImage2D is an offset into the buffer
+	
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, sx, sy, uploadFormat, uploadElementType, nullptr);
+	
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, restoreTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, restoreUnpackAlignment);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, restoreUnpackRowLength);
+	checkErrorGL();
+	
+	nextBufferIndex = (nextBufferIndex + 1) % kNumBuffers;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "framework.h"
+
+/*
+
+VfxStreamingTexture is a texture whose contents are replaced every frame, like the images of a camera. the
+texture is allocated once, and updated in place with glTexSubImage2D from a ring of pixel buffer objects.
+the buffer is orphaned before it's mapped, so mapping never waits for the GPU to finish reading a previous
+upload, and the upload from the buffer into the texture is done asynchronously by the driver.
+
+usage:
+	
+	VfxStreamingTexture texture;
+	
+	texture.allocate(640, 480, GL_R16, GL_RED, GL_UNSIGNED_SHORT, true, true);
+	
+	void * pixels = texture.beginUpdate();
+	
+	if (pixels != nullptr)
+	{
+		memcpy(pixels, source, texture.getUpdateSize());
+		
+		texture.endUpdate();
+	}
+
+*/
+
+struct VfxStreamingTexture
+{
+	static const int kNumBuffers = 3;
+	
+	GLuint texture;
+	GLuint buffers[kNumBuffers];
+	int nextBufferIndex;
+	
+	int sx;
+	int sy;
+	int bytesPerPixel;
+	GLenum uploadFormat;
+	GLenum uploadElementType;
+	
+	bool isMapped;
+	
+	VfxStreamingTexture();
+	~VfxStreamingTexture();
+	
+	bool allocate(const int sx, const int sy, const GLenum internalFormat, const GLenum uploadFormat, const GLenum uploadElementType, const bool filter, const bool clamp);
+	void free();
+	
+	bool isAllocated() const
+	{
+		return texture != 0;
+	}
+	
+	int getUpdateSize() const
+	{
+		return sx * sy * bytesPerPixel;
+	}
+	
+	void setSwizzle(const GLint r, const GLint g, const GLint b, const GLint a);
+	
+	// maps the next pixel buffer, and returns a pointer to write getUpdateSize() bytes of pixels to. the pixels
+	// are tightly packed. returns null when the buffer couldn't be mapped
+	
+	void * beginUpdate();
+	void endUpdate();
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+/*
+
+VfxTripleBuffer hands the latest of a stream of frames from a producer thread to a consumer thread, without
+taking locks. it manages the indices of three buffers, which are owned by the user. the producer writes into
+one buffer and the consumer reads from another. the third buffer holds the most recently published frame, and
+is exchanged atomically with the producer's buffer when it publishes a frame, and with the consumer's buffer
+when it acquires one. the producer never waits for the consumer, and frames the consumer doesn't get around
+to reading are dropped, with the latest frame winning. neither side ever sees a buffer the other side is using.
+
+usage:
+	
+	Frame frames[3];
+	VfxTripleBuffer exchange;
+	
+	// producer thread
+	
+	fill(frames[exchange.writeIndex]);
+	
+	exchange.publish();
+	
+	// consumer thread
+	
+	if (exchange.acquire())
+		use(frames[exchange.readIndex]);
+
+*/
+
+struct VfxTripleBuffer
+{
+	static const int kFreshBit = 4;
+	
+	int writeIndex; // only accessed by the producer
+	int readIndex; // only accessed by the consumer
+	
+	SDL_atomic_t middleIndex; // the index of the buffer in the middle, plus kFreshBit when it holds a frame which wasn't acquired yet
+	
+	VfxTripleBuffer()
+		: writeIndex(0)
+		, readIndex(1)
+	{
+		SDL_AtomicSet(&middleIndex, 2);
+	}
+	
+	// publishes the frame at writeIndex. writeIndex is set to the buffer to write the next frame into
+	
+	void publish()
+	{
+		writeIndex = exchange(writeIndex | kFreshBit) & ~kFreshBit;
+	}
+	
+	// makes the most recently published frame available at readIndex. returns false when no frame was published
+	// since the last call, in which case readIndex is left alone
+	
+	bool acquire()
+	{
+		if ((SDL_AtomicGet(&middleIndex) & kFreshBit) == 0)
+			return false;
+		
+		// note : only the producer may publish in between, which leaves a fresh frame in the middle as well
+		
+		readIndex = exchange(readIndex) & ~kFreshBit;
+		
+		return true;
+	}
+	
+	int exchange(const int index)
+	{
+		// make sure the writes to, or reads from, our buffer have finished before handing it over, and that the
+		// buffer we get in return is only accessed after the exchange
+		
+		SDL_MemoryBarrierRelease();
+		
+		const int result = SDL_AtomicSet(&middleIndex, index);
+		
+		SDL_MemoryBarrierAcquire();
+		
+		return result;
+	}
+};
@@ -422,6 +422,14 @@ void UiElem::deactivate()
 	isActive = false;
 }
 
+bool UiState::isEditingText() const
+{
+	return
+		activeElem != nullptr &&
+		activeElem->textField != nullptr &&
+		activeElem->textField->isActive();
+}
+
 //
 
 void makeActive(UiState * state, const bool doActions, const bool doDraw)
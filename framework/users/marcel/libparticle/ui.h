@@ -29,6 +29,10 @@ struct UiState
 	~UiState();
 	
 	void reset();
+	
+	// returns true while a text box is open for editing. text boxes update their value on every keystroke
+	
+	bool isEditingText() const;
 };
 
 extern UiState * g_uiState;
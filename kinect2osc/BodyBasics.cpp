@@ -10,42 +10,55 @@
 #include "BodyBasics.h"
 
 #include "ip/UdpSocket.h"
+#include "osc/OscBundleSender.h"
 #include "osc/OscOutboundPacketStream.h"
 #include "osc/OscPacketListener.h"
 #include <string>
 
-#define OSC_BUFFER_SIZE 1000
 static std::string OSC_DEST_ADDRESS_1 = "10.10.150.153";
 static std::string OSC_DEST_ADDRESS_2 = "10.10.150.148";
 #define OSC_DEST_PORT 7000
 
+// send all tracked bodies as /joints/<body index>, instead of only the first tracked body as /joints
+static bool OSC_SEND_ALL_BODIES = false;
+// send the joint coordinates as a single blob of floats, instead of one float argument per coordinate
+static bool OSC_SEND_BLOBS = false;
+
 static UdpTransmitSocket * transmitSocket = 0;
+static IpEndpointName destEndpoint1;
+static IpEndpointName destEndpoint2;
 
-static void SendJointPoints(D2D1_POINT_2F * joints, int numJoints)
-{
-	char buffer[OSC_BUFFER_SIZE];
+// all bodies of a frame are sent as one bundle, which is split into multiple packets when it exceeds the MTU
+static osc::BundleSender * bundleSender = 0;
 
-	osc::OutboundPacketStream p(buffer, OSC_BUFFER_SIZE);
+static void BeginJointFrame()
+{
+	bundleSender->BeginFrame();
+}
 
-	p
-		<< osc::BeginBundleImmediate
-		<< osc::BeginMessage("/joints");
+static void AddJointPoints(const char * address, D2D1_POINT_2F * joints, int numJoints)
+{
+	float values[JointType_Count * 3];
 
 	for (int i = 0; i < numJoints; ++i)
 	{
-		p
-			<< joints[i].x
-			<< joints[i].y
-			<< 0.f;
+		values[i * 3 + 0] = joints[i].x;
+		values[i * 3 + 1] = joints[i].y;
+		values[i * 3 + 2] = 0.f;
+	}
+
+	bundleSender->AddFloatMessage(address, values, numJoints * 3, OSC_SEND_BLOBS);
+}
+
+static void EndJointFrame()
+{
+	bundleSender->EndFrame();
+
+	for (size_t i = 0; i < bundleSender->PacketCount(); ++i)
+	{
+		transmitSocket->SendTo(destEndpoint1, bundleSender->PacketData(i), bundleSender->PacketSize(i));
+		transmitSocket->SendTo(destEndpoint2, bundleSender->PacketData(i), bundleSender->PacketSize(i));
 	}
-	p
-		<< osc::EndMessage
-		<< osc::EndBundle;
-
-	IpEndpointName ip1(OSC_DEST_ADDRESS_1.c_str(), OSC_DEST_PORT);
-	IpEndpointName ip2(OSC_DEST_ADDRESS_2.c_str(), OSC_DEST_PORT);
-	transmitSocket->SendTo(ip1, p.Data(), p.Size());
-	transmitSocket->SendTo(ip2, p.Data(), p.Size());
 }
 
 static const float c_JointThickness = 3.0f;
@@ -77,12 +90,22 @@ int APIENTRY wWinMain(
 		OSC_DEST_ADDRESS_1 = env;
 	if (GetEnvironmentVariableA("ip2", env, 256) > 0)
 		OSC_DEST_ADDRESS_2 = env;
+	if (GetEnvironmentVariableA("allbodies", env, 256) > 0)
+		OSC_SEND_ALL_BODIES = atoi(env) != 0;
+	if (GetEnvironmentVariableA("blobs", env, 256) > 0)
+		OSC_SEND_BLOBS = atoi(env) != 0;
 
 	printf("ip1 = %s\n", OSC_DEST_ADDRESS_1.c_str());
 	printf("ip2 = %s\n", OSC_DEST_ADDRESS_2.c_str());
 
 	transmitSocket = new UdpTransmitSocket(IpEndpointName(OSC_DEST_ADDRESS_1.c_str(), OSC_DEST_PORT));
 
+	// resolve the destination addresses once, rather than for each frame
+	destEndpoint1 = IpEndpointName(OSC_DEST_ADDRESS_1.c_str(), OSC_DEST_PORT);
+	destEndpoint2 = IpEndpointName(OSC_DEST_ADDRESS_2.c_str(), OSC_DEST_PORT);
+
+	bundleSender = new osc::BundleSender();
+
     CBodyBasics application;
     application.Run(hInstance, nShowCmd);
 }
@@ -368,6 +391,8 @@ HRESULT CBodyBasics::InitializeDefaultSensor()
 /// </summary>
 void CBodyBasics::ProcessBody(INT64 nTime, int nBodyCount, IBody** ppBodies)
 {
+	BeginJointFrame();
+
 	for (int i = 0; i < nBodyCount; ++i)
 	{
 		int width = 1024;
@@ -400,14 +425,26 @@ void CBodyBasics::ProcessBody(INT64 nTime, int nBodyCount, IBody** ppBodies)
 						jointPoints[j].y -= height/2;
 					}
 
-					SendJointPoints(jointPoints, _countof(joints));
+					if (OSC_SEND_ALL_BODIES)
+					{
+						char address[32];
+						sprintf_s(address, "/joints/%d", i);
+
+						AddJointPoints(address, jointPoints, _countof(joints));
+					}
+					else
+					{
+						AddJointPoints("/joints", jointPoints, _countof(joints));
 
-					break;
+						break;
+					}
 				}
 			}
 		}
 	}
 
+	EndJointFrame();
+
     if (m_hWnd)
     {
         HRESULT hr = EnsureDirect2DResources();
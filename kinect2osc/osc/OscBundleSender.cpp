@@ -0,0 +1,120 @@
+#include "OscBundleSender.h"
+
+#include <cassert>
+
+#include "OscHostEndianness.h"
+
+
+namespace osc{
+
+static inline std::size_t RoundUp4( std::size_t x )
+{
+    return (x + 3) & ~((std::size_t)0x03);
+}
+
+
+BundleSender::BundleSender( std::size_t maxPacketSize )
+    : pool_( maxPacketSize )
+    , maxPacketSize_( maxPacketSize )
+    , timeTag_( 1 )
+    , current_( 0 )
+    , currentMessageCount_( 0 )
+{
+}
+
+
+void BundleSender::BeginFrame( uint64 timeTag )
+{
+    assert( current_ == 0 );
+
+    pool_.ReleaseAll();
+
+    timeTag_ = timeTag;
+}
+
+
+void BundleSender::AddFloatMessage( const char *addressPattern,
+        const float *values, std::size_t numValues, bool asBlob )
+{
+    // the size of the message once it's been added to the bundle, including
+    // its element size slot. the address pattern and type tag strings are
+    // null terminated and padded to a multiple of four bytes
+    std::size_t messageSize = 4 + RoundUp4( std::strlen(addressPattern) + 1 );
+    if( asBlob )
+        messageSize += RoundUp4( 1 + 1 + 1 ) + 4 + numValues * 4;
+    else
+        messageSize += RoundUp4( 1 + numValues + 1 ) + numValues * 4;
+
+    // bundles start with "#bundle\0" followed by the time tag
+    const std::size_t bundleHeaderSize = 16;
+
+    if( bundleHeaderSize + messageSize > maxPacketSize_ )
+        throw OutOfBufferMemoryException( "message doesn't fit in a single packet" );
+
+    if( current_ != 0 && currentMessageCount_ != 0 && current_->Size() + messageSize > maxPacketSize_ )
+        EndPacket();
+
+    if( current_ == 0 )
+        BeginPacket();
+
+    OutboundPacketStream& p = *current_;
+
+    p << BeginMessage( addressPattern );
+
+    if( asBlob ){
+        blob_.resize( numValues * 4 );
+
+        char *dst = blob_.empty() ? 0 : &blob_[0];
+
+        for( std::size_t i=0; i < numValues; ++i ){
+#ifdef OSC_HOST_LITTLE_ENDIAN
+            const char *src = reinterpret_cast<const char*>(values + i);
+            dst[0] = src[3];
+            dst[1] = src[2];
+            dst[2] = src[1];
+            dst[3] = src[0];
+#else
+            std::memcpy( dst, values + i, 4 );
+#endif
+            dst += 4;
+        }
+
+        p << Blob( blob_.empty() ? 0 : &blob_[0], (osc_bundle_element_size_t)blob_.size() );
+    }else{
+        for( std::size_t i=0; i < numValues; ++i )
+            p << values[i];
+    }
+
+    p << EndMessage;
+
+    currentMessageCount_++;
+
+    assert( p.Size() <= maxPacketSize_ );
+}
+
+
+void BundleSender::EndFrame()
+{
+    if( current_ != 0 )
+        EndPacket();
+}
+
+
+void BundleSender::BeginPacket()
+{
+    current_ = &pool_.Acquire();
+    currentMessageCount_ = 0;
+
+    *current_ << BeginBundle( timeTag_ );
+}
+
+
+void BundleSender::EndPacket()
+{
+    *current_ << EndBundle;
+
+    current_ = 0;
+    currentMessageCount_ = 0;
+}
+
+} // namespace osc
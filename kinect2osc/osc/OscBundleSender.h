@@ -0,0 +1,67 @@
+#ifndef INCLUDED_OSCPACK_OSCBUNDLESENDER_H
+#define INCLUDED_OSCPACK_OSCBUNDLESENDER_H
+
+#include <cstring> // size_t
+#include <vector>
+
+#include "OscOutboundPacketStream.h"
+
+
+namespace osc{
+
+// BundleSender gathers the messages of a frame into bundles that share a
+// single time tag. when the next message would make the current packet
+// larger than maxPacketSize, it starts a new packet with its own bundle,
+// so each packet fits in the network MTU. the packet buffers are taken
+// from an OutboundPacketPool and are reused from frame to frame.
+//
+// usage:
+//
+//    sender.BeginFrame();
+//    sender.AddFloatMessage( "/joints", values, numValues );
+//    sender.EndFrame();
+//
+//    for( std::size_t i=0; i < sender.PacketCount(); ++i )
+//        socket.Send( sender.PacketData(i), sender.PacketSize(i) );
+
+class BundleSender{
+public:
+    // 1500 byte ethernet MTU minus the IPv4 and UDP headers
+    enum { DEFAULT_MAX_PACKET_SIZE = 1472 };
+
+    BundleSender( std::size_t maxPacketSize=DEFAULT_MAX_PACKET_SIZE );
+
+    void BeginFrame( uint64 timeTag=1 );
+
+    // adds a message with float arguments. when asBlob is set the values are
+    // sent as a single blob of big endian 32 bit floats, rather than as one
+    // float argument each, which saves a type tag byte per value.
+    // throws OutOfBufferMemoryException when the message alone doesn't fit
+    // in a packet
+    void AddFloatMessage( const char *addressPattern,
+            const float *values, std::size_t numValues, bool asBlob=false );
+
+    void EndFrame();
+
+    // the packets built during the last frame. valid until the next call to BeginFrame
+    std::size_t PacketCount() const { return pool_.Count(); }
+    const char *PacketData( std::size_t index ) const { return pool_[index].Data(); }
+    std::size_t PacketSize( std::size_t index ) const { return pool_[index].Size(); }
+
+private:
+    void BeginPacket();
+    void EndPacket();
+
+    OutboundPacketPool pool_;
+    std::size_t maxPacketSize_;
+
+    uint64 timeTag_;
+    OutboundPacketStream *current_;
+    std::size_t currentMessageCount_;
+
+    std::vector<char> blob_;
+};
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCPACK_OSCBUNDLESENDER_H */
@@ -38,6 +38,7 @@
 #define INCLUDED_OSCPACK_OSCOUTBOUNDPACKETSTREAM_H
 
 #include <cstring> // size_t
+#include <vector>
 
 #include "OscTypes.h"
 #include "OscException.h"
@@ -149,6 +150,42 @@ private:
     bool messageIsInProgress_;
 };
 
+
+// OutboundPacketPool owns a set of preallocated packet buffers, each with
+// an OutboundPacketStream writing into it. packets are handed out with
+// Acquire and returned all at once with ReleaseAll, so a sender can build
+// several packets per frame without allocating memory once the pool has
+// grown to its steady state size.
+
+class OutboundPacketPool{
+public:
+    OutboundPacketPool( std::size_t packetCapacity );
+    ~OutboundPacketPool();
+
+    // returns a cleared packet stream. grows the pool when all packets are in use
+    OutboundPacketStream& Acquire();
+
+    void ReleaseAll();
+
+    std::size_t PacketCapacity() const { return packetCapacity_; }
+
+    // the number of packets acquired since the last call to ReleaseAll
+    std::size_t Count() const { return count_; }
+
+    OutboundPacketStream& operator[]( std::size_t index ) { return *streams_[index]; }
+    const OutboundPacketStream& operator[]( std::size_t index ) const { return *streams_[index]; }
+
+private:
+    OutboundPacketPool( const OutboundPacketPool& );
+    OutboundPacketPool& operator=( const OutboundPacketPool& );
+
+    std::size_t packetCapacity_;
+    std::size_t count_;
+
+    std::vector<char*> buffers_;
+    std::vector<OutboundPacketStream*> streams_;
+};
+
 } // namespace osc
 
 #endif /* INCLUDED_OSCPACK_OSCOUTBOUNDPACKETSTREAM_H */